@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Turn an app_trace dump into per-phase latency histograms.
+
+Reads device logs containing the output of app_trace_dump() or the
+"app_trace dump" shell command, pairs the begin and end markers of each
+phase and prints a histogram of the phase durations. Several dumps can be
+concatenated into one input.
+"""
+
+import argparse
+import collections
+import re
+import sys
+
+HZ_RE = re.compile(r'app_trace: hz (\d+)')
+MARKER_RE = re.compile(r'app_trace: (\d+) (\w+) ([BE])')
+CYCLES_WRAP = 1 << 32
+
+
+def parse(lines):
+    hz = None
+    begins = {}
+    durations = collections.defaultdict(list)
+
+    for line in lines:
+        match = HZ_RE.search(line)
+        if match:
+            hz = int(match.group(1))
+            # Markers of a new dump are not paired with the previous one.
+            begins.clear()
+            continue
+
+        match = MARKER_RE.search(line)
+        if not match or hz is None:
+            continue
+
+        cycles, phase, kind = int(match.group(1)), match.group(2), \
+            match.group(3)
+
+        if kind == 'B':
+            begins[phase] = cycles
+        elif phase in begins:
+            delta = (cycles - begins.pop(phase)) % CYCLES_WRAP
+            durations[phase].append(delta * 1000000 // hz)
+
+    return durations
+
+
+def bucket_bounds(values, bins):
+    """Logarithmic bucket upper bounds in microseconds."""
+    bound = 1
+    while bound < min(values):
+        bound *= 2
+    bounds = []
+    while len(bounds) < bins and (not bounds or bounds[-1] < max(values)):
+        bounds.append(bound)
+        bound *= 2
+    return bounds
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def print_histogram(phase, values, bins, width):
+    values = sorted(values)
+    print('{}: {} samples, min {} us, p50 {} us, p90 {} us, max {} us'
+          .format(phase, len(values), values[0], percentile(values, 50),
+                  percentile(values, 90), values[-1]))
+
+    bounds = bucket_bounds(values, bins)
+    counts = [0] * len(bounds)
+    for value in values:
+        for i, bound in enumerate(bounds):
+            if value <= bound or i == len(bounds) - 1:
+                counts[i] += 1
+                break
+
+    peak = max(counts)
+    for bound, count in zip(bounds, counts):
+        bar = '#' * (count * width // peak) if peak else ''
+        print('  <= {:>10} us {:>6} {}'.format(bound, count, bar))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin,
+                        help='log file with app_trace dumps, default stdin')
+    parser.add_argument('--phase', action='append',
+                        help='only show the given phase, can be repeated')
+    parser.add_argument('--bins', type=int, default=16,
+                        help='maximum number of histogram buckets')
+    parser.add_argument('--width', type=int, default=50,
+                        help='width of the histogram bars')
+    args = parser.parse_args()
+
+    durations = parse(args.log)
+    if not durations:
+        sys.exit('No complete app_trace phases found')
+
+    for phase in sorted(durations):
+        if args.phase and phase not in args.phase:
+            continue
+        print_histogram(phase, durations[phase], args.bins, args.width)
+
+
+if __name__ == '__main__':
+    main()
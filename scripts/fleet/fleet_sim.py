@@ -0,0 +1,391 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Run a fleet of emulated trackers against an MQTT broker.
+
+Each tracker is an MQTT client with a fake IMEI as client ID. It follows
+the connection behavior of the firmware: reconnect delays with the
+jittered exponential backoff of cloud_poll(), sensor data published to
+the shadow update topic, reported configuration sent back after a
+configuration delta, and a reboot after a FOTA job. A scenario file
+drives the fleet through outages, configuration pushes and FOTA waves.
+
+Publish latency (time to PUBACK), connect time (first attempt to
+CONNACK), configuration delivery latency and FOTA offline time are
+written per instance to a CSV file and summarized at the end, together
+with the peak connection attempt rate seen by the broker.
+
+Requires paho-mqtt. Example against a local mosquitto:
+
+    fleet_sim.py --devices 200 scenarios/outage.json
+"""
+
+import argparse
+import collections
+import csv
+import json
+import random
+import socket
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+AWS = '$aws/things/'
+
+# Events without a duration, only counted in the summary.
+MARKERS = ('connect_attempt', 'connect_failed', 'link_lost',
+           'connection_lost')
+
+
+def client_new(client_id):
+    try:
+        return mqtt.Client(mqtt.CallbackAPIVersion.VERSION2,
+                           client_id=client_id)
+    except AttributeError:
+        # paho-mqtt 1.x
+        return mqtt.Client(client_id=client_id)
+
+
+class Recorder:
+    """Thread-safe collection of per-instance measurements."""
+
+    def __init__(self):
+        self.start = time.monotonic()
+        self.lock = threading.Lock()
+        self.rows = []
+
+    def add(self, device, kind, value_ms=0):
+        t = time.monotonic() - self.start
+        with self.lock:
+            self.rows.append((round(t, 3), device, kind, round(value_ms)))
+
+    def write(self, path):
+        with open(path, 'w', newline='') as f:
+            writer = csv.writer(f)
+            writer.writerow(('time', 'device', 'event', 'ms'))
+            writer.writerows(self.rows)
+
+    def summary(self, out):
+        values = collections.defaultdict(list)
+        markers = collections.Counter()
+        attempts = collections.Counter()
+
+        for t, _, kind, value in self.rows:
+            if kind in MARKERS:
+                markers[kind] += 1
+            else:
+                values[kind].append(value)
+
+            if kind == 'connect_attempt':
+                attempts[int(t)] += 1
+
+        out.write('{:<16} {:>7} {:>9} {:>9} {:>9} {:>9}\n'.format(
+            'event', 'count', 'p50 ms', 'p90 ms', 'p99 ms', 'max ms'))
+        for kind in sorted(values):
+            v = sorted(values[kind])
+            out.write('{:<16} {:>7} {:>9} {:>9} {:>9} {:>9}\n'.format(
+                kind, len(v), percentile(v, 50), percentile(v, 90),
+                percentile(v, 99), v[-1]))
+
+        for kind in MARKERS:
+            out.write('{:<16} {:>7}\n'.format(kind, markers[kind]))
+
+        if attempts:
+            second, peak = attempts.most_common(1)[0]
+            out.write('peak connection attempts: {}/s at {} s\n'.format(
+                peak, second))
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, len(values) * p // 100)]
+
+
+class Tracker(threading.Thread):
+    """One emulated device, mirroring cloud_poll() and the publish path."""
+
+    def __init__(self, fleet, index):
+        super().__init__(daemon=True)
+        self.fleet = fleet
+        self.args = fleet.args
+        self.id = '{}{:0{}d}'.format(self.args.imei_prefix, index,
+                                     15 - len(self.args.imei_prefix))
+        self.link_up = threading.Event()
+        self.link_up.set()
+        self.fota_pending = False
+        self.pending = {}
+        self.connected = threading.Event()
+        self.client = None
+        self.rng = random.Random(self.id)
+
+    def backoff_delay(self, backoff):
+        return self.rng.uniform(backoff / 2, backoff)
+
+    def connect(self):
+        rec = self.fleet.recorder
+        client = client_new(self.id)
+        client.on_connect = self.on_connect
+        client.on_disconnect = self.on_disconnect
+        client.on_publish = self.on_publish
+        client.on_message = self.on_message
+        self.connected.clear()
+
+        rec.add(self.id, 'connect_attempt')
+        try:
+            client.connect(self.args.host, self.args.port,
+                           keepalive=self.args.keepalive)
+        except OSError:
+            return None
+
+        deadline = time.monotonic() + self.args.connect_timeout
+        while not self.connected.is_set() and time.monotonic() < deadline:
+            client.loop(timeout=0.1)
+
+        if not self.connected.is_set():
+            client.disconnect()
+            return None
+
+        client.subscribe([
+            (AWS + self.id + '/shadow/get/accepted/desired/cfg', 1),
+            (AWS + self.id + '/shadow/update/delta', 1),
+            (AWS + self.id + '/jobs/notify-next', 1),
+        ])
+        return client
+
+    def run(self):
+        rec = self.fleet.recorder
+        backoff = 0
+        connect_start = None
+
+        while not self.fleet.stop.is_set():
+            self.link_up.wait()
+
+            if backoff:
+                time.sleep(self.backoff_delay(backoff))
+
+            if connect_start is None:
+                connect_start = time.monotonic()
+
+            self.client = self.connect()
+            if self.client is None:
+                rec.add(self.id, 'connect_failed')
+                backoff = min(backoff * 2, self.args.backoff_max) \
+                    if backoff else self.args.backoff_min
+                continue
+
+            rec.add(self.id, 'connect_time',
+                    (time.monotonic() - connect_start) * 1000)
+            connect_start = None
+            backoff = 0
+
+            rebooted = self.session()
+            # A rebooted device connects again right away, a dropped
+            # connection waits for the minimum backoff.
+            backoff = 0 if rebooted else self.args.backoff_min
+
+    def session(self):
+        next_publish = time.monotonic() + self.rng.uniform(
+            0, self.args.interval)
+
+        while not self.fleet.stop.is_set():
+            if not self.link_up.is_set():
+                self.drop()
+                return False
+
+            if self.fota_pending:
+                self.fota()
+                return True
+
+            if time.monotonic() >= next_publish:
+                self.publish_sensor_data()
+                next_publish += self.args.interval
+
+            if self.client.loop(timeout=0.2) != mqtt.MQTT_ERR_SUCCESS or \
+               not self.connected.is_set():
+                self.fleet.recorder.add(self.id, 'connection_lost')
+                return False
+
+        self.client.disconnect()
+        return False
+
+    def drop(self):
+        """Loses the link without an MQTT DISCONNECT, as in an outage."""
+        sock = self.client.socket()
+        if sock:
+            try:
+                sock.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+        self.client.loop(timeout=0.1)
+        self.fleet.recorder.add(self.id, 'link_lost')
+
+    def fota(self):
+        rec = self.fleet.recorder
+        self.fota_pending = False
+        start = time.monotonic()
+
+        # Download, then publish buffered data before the reboot.
+        time.sleep(self.rng.uniform(*self.args.fota_download))
+        self.publish_sensor_data()
+        self.client.loop(timeout=0.5)
+        self.client.disconnect()
+        time.sleep(self.args.boot_time)
+        rec.add(self.id, 'fota_offline', (time.monotonic() - start) * 1000)
+
+    def publish_sensor_data(self):
+        payload = json.dumps({'state': {'reported': {
+            'bat': {'v': 3700, 'ts': int(time.time() * 1000)}}}})
+        info = self.client.publish(AWS + self.id + '/shadow/update',
+                                   payload, qos=1)
+        self.pending[info.mid] = time.monotonic()
+
+    # The callbacks take the arguments of both paho-mqtt 1.x and 2.x.
+    def on_connect(self, client, userdata, flags, rc, *args):
+        if rc == 0:
+            self.connected.set()
+
+    def on_disconnect(self, client, userdata, *args):
+        self.connected.clear()
+
+    def on_publish(self, client, userdata, mid, *args):
+        sent = self.pending.pop(mid, None)
+        if sent is not None:
+            self.fleet.recorder.add(self.id, 'publish_latency',
+                                    (time.monotonic() - sent) * 1000)
+
+    def on_message(self, client, userdata, msg):
+        rec = self.fleet.recorder
+
+        if msg.topic.endswith('/jobs/notify-next'):
+            self.fota_pending = True
+            return
+
+        try:
+            doc = json.loads(msg.payload)
+        except ValueError:
+            return
+
+        if 'sent' in doc:
+            rec.add(self.id, 'cfg_latency',
+                    (time.time() - doc['sent']) * 1000)
+
+        cfg = doc.get('state', {}).get('cfg')
+        if cfg:
+            client.publish(AWS + self.id + '/shadow/update', json.dumps(
+                {'state': {'reported': {'cfg': cfg}}}), qos=0)
+
+
+class Fleet:
+    def __init__(self, args):
+        self.args = args
+        self.recorder = Recorder()
+        self.stop = threading.Event()
+        self.trackers = [Tracker(self, i) for i in range(args.devices)]
+        self.version = 0
+        self.controller = client_new('fleet-sim-controller')
+        self.controller.connect(args.host, args.port)
+        self.controller.loop_start()
+
+    def select(self, step):
+        count = round(len(self.trackers) * step.get('fraction', 1.0))
+        return random.sample(self.trackers, count)
+
+    def outage(self, step):
+        trackers = self.select(step)
+        for tracker in trackers:
+            tracker.link_up.clear()
+        time.sleep(step.get('duration', 60))
+        # Coverage returns for all devices of a cell at once.
+        for tracker in trackers:
+            tracker.link_up.set()
+
+    def cfg_push(self, step):
+        self.version += 1
+        for tracker in self.select(step):
+            payload = json.dumps({'state': {'cfg': step.get('cfg', {})},
+                                  'version': self.version,
+                                  'sent': time.time()})
+            self.controller.publish(
+                AWS + tracker.id + '/shadow/update/delta', payload, qos=1)
+
+    def fota_wave(self, step):
+        trackers = self.select(step)
+        spread = step.get('spread', 0)
+        for tracker in trackers:
+            self.controller.publish(
+                AWS + tracker.id + '/jobs/notify-next',
+                json.dumps({'execution': {'jobId': 'fleet-sim'}}), qos=1)
+            if spread:
+                time.sleep(spread / len(trackers))
+
+    def run(self, scenario):
+        start = time.monotonic()
+
+        for tracker in self.trackers:
+            tracker.start()
+            if self.args.ramp:
+                time.sleep(self.args.ramp / len(self.trackers))
+
+        for step in sorted(scenario.get('steps', []),
+                           key=lambda s: s['at']):
+            time.sleep(max(0, start + step['at'] - time.monotonic()))
+            print('{:7.1f} s: {}'.format(time.monotonic() - start,
+                                         step['action']), file=sys.stderr)
+            getattr(self, step['action'])(step)
+
+        time.sleep(max(0, start + scenario.get('duration', 0) -
+                       time.monotonic()))
+        self.stop.set()
+        for tracker in self.trackers:
+            tracker.join(timeout=2)
+        self.controller.loop_stop()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('scenario', help='scenario JSON file')
+    parser.add_argument('--host', default='localhost')
+    parser.add_argument('--port', type=int, default=1883)
+    parser.add_argument('--devices', type=int, default=None,
+                        help='number of trackers, overrides the scenario')
+    parser.add_argument('--imei-prefix', default='35')
+    parser.add_argument('--interval', type=float, default=60,
+                        help='seconds between sensor data publishes')
+    parser.add_argument('--keepalive', type=int, default=1200)
+    parser.add_argument('--connect-timeout', type=float, default=30)
+    parser.add_argument('--backoff-min', type=float, default=5,
+                        help='CONFIG_CLOUD_RECONNECT_BACKOFF_MIN')
+    parser.add_argument('--backoff-max', type=float, default=900,
+                        help='CONFIG_CLOUD_RECONNECT_BACKOFF_MAX')
+    parser.add_argument('--fota-download', type=float, nargs=2,
+                        default=(30, 120), metavar=('MIN', 'MAX'),
+                        help='seconds a FOTA download takes')
+    parser.add_argument('--boot-time', type=float, default=20,
+                        help='seconds offline while rebooting')
+    parser.add_argument('--ramp', type=float, default=10,
+                        help='seconds over which the trackers are started')
+    parser.add_argument('--output', default='fleet_sim.csv')
+    args = parser.parse_args()
+
+    with open(args.scenario) as f:
+        scenario = json.load(f)
+
+    if args.devices is None:
+        args.devices = scenario.get('devices', 100)
+
+    fleet = Fleet(args)
+    try:
+        fleet.run(scenario)
+    except KeyboardInterrupt:
+        fleet.stop.set()
+
+    fleet.recorder.write(args.output)
+    fleet.recorder.summary(sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Convert a recorded GPS trace into the C table of the replay driver.
+
+The input is a CSV file with the columns
+
+    timestamp,latitude,longitude,altitude,accuracy,speed,satellites
+
+where timestamp is UTC in seconds since the epoch. Rows without a
+latitude mark a dropout and are skipped; the driver reports no fix when
+the gap to the previous record exceeds CONFIG_GPS_REPLAY_MAX_GAP.
+"""
+
+import argparse
+import csv
+import sys
+
+HEADER = '''/*
+ * Generated by gps_replay_trace.py from {source}, do not edit.
+ */
+
+#include "gps_replay.h"
+
+const s64_t gps_replay_trace_epoch = {epoch}LL;
+
+const struct gps_replay_record gps_replay_trace[] = {{
+'''
+
+FOOTER = '''}};
+
+const size_t gps_replay_trace_len = ARRAY_SIZE(gps_replay_trace);
+'''
+
+
+def parse(lines):
+    records = []
+
+    for row in csv.DictReader(lines):
+        if not row['latitude']:
+            continue
+
+        records.append((
+            float(row['timestamp']),
+            float(row['latitude']),
+            float(row['longitude']),
+            float(row['altitude'] or 0),
+            float(row['accuracy'] or 0),
+            float(row['speed'] or 0),
+            int(row['satellites'] or 0),
+        ))
+
+    if not records:
+        raise ValueError('no records')
+
+    records.sort()
+
+    return records
+
+
+def write(records, source, out):
+    epoch = int(records[0][0] * 1000)
+
+    out.write(HEADER.format(source=source, epoch=epoch))
+
+    for ts, lat, lng, alt, accuracy, speed, sats in records:
+        out.write('\t{{ {}, {:.7f}, {:.7f}, {:.1f}f, {:.1f}f, {:.2f}f, '
+                  '{} }},\n'.format(int(ts * 1000) - epoch, lat, lng, alt,
+                                    accuracy, speed, sats))
+
+    out.write(FOOTER.format())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', help='recorded trace, CSV')
+    parser.add_argument('output', help='generated C file')
+    args = parser.parse_args()
+
+    with open(args.input, newline='') as f:
+        try:
+            records = parse(f)
+        except (KeyError, ValueError) as e:
+            sys.exit('{}: invalid trace: {}'.format(args.input, e))
+
+    with open(args.output, 'w') as f:
+        write(records, args.input.split('/')[-1], f)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <atomic.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "app_trace.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(app_trace, CONFIG_APP_TRACE_LOG_LEVEL);
+
+BUILD_ASSERT_MSG((CONFIG_APP_TRACE_BUFFER_SIZE &
+		  (CONFIG_APP_TRACE_BUFFER_SIZE - 1)) == 0,
+		 "APP_TRACE_BUFFER_SIZE must be a power of two");
+
+struct marker {
+	u32_t cycles;
+	u8_t phase;
+	bool end;
+};
+
+struct phase {
+	u32_t begin;
+	bool active;
+	struct app_trace_summary summary;
+};
+
+static const char * const phase_names[] = {
+	[APP_TRACE_GPS_SEARCH] = "gps_search",
+	[APP_TRACE_MODEM_INFO] = "modem_info",
+	[APP_TRACE_ENCODE] = "encode",
+	[APP_TRACE_CLOUD_SEND] = "cloud_send",
+	[APP_TRACE_CLOUD_INPUT] = "cloud_input",
+	[APP_TRACE_LED] = "led",
+	[APP_TRACE_NETWORK_TIME] = "network_time",
+	[APP_TRACE_NTP] = "ntp",
+};
+
+BUILD_ASSERT_MSG(ARRAY_SIZE(phase_names) == APP_TRACE_PHASE_COUNT,
+		 "Missing phase name");
+
+static struct marker ring[CONFIG_APP_TRACE_BUFFER_SIZE];
+static atomic_t head;
+
+static struct phase phases[APP_TRACE_PHASE_COUNT];
+static struct k_spinlock lock;
+
+static u32_t marker_add(enum app_trace_phase phase, bool end)
+{
+	u32_t cycles = k_cycle_get_32();
+	u32_t idx = (u32_t)atomic_inc(&head) &
+		    (CONFIG_APP_TRACE_BUFFER_SIZE - 1);
+
+	ring[idx] = (struct marker) {
+		.cycles = cycles,
+		.phase = phase,
+		.end = end
+	};
+
+	return cycles;
+}
+
+void app_trace_begin(enum app_trace_phase phase)
+{
+	u32_t cycles;
+	k_spinlock_key_t key;
+
+	__ASSERT_NO_MSG(phase < APP_TRACE_PHASE_COUNT);
+
+	cycles = marker_add(phase, false);
+
+	key = k_spin_lock(&lock);
+	phases[phase].begin = cycles;
+	phases[phase].active = true;
+	k_spin_unlock(&lock, key);
+}
+
+void app_trace_end(enum app_trace_phase phase)
+{
+	struct app_trace_summary *summary;
+	u32_t cycles, duration;
+	k_spinlock_key_t key;
+
+	__ASSERT_NO_MSG(phase < APP_TRACE_PHASE_COUNT);
+
+	cycles = marker_add(phase, true);
+
+	key = k_spin_lock(&lock);
+
+	if (!phases[phase].active) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	duration = (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(
+				cycles - phases[phase].begin) / 1000);
+	summary = &phases[phase].summary;
+
+	phases[phase].active = false;
+
+	if (summary->count == 0 || duration < summary->min_us) {
+		summary->min_us = duration;
+	}
+
+	summary->max_us = MAX(summary->max_us, duration);
+	summary->sum_us += duration;
+	summary->count++;
+
+	k_spin_unlock(&lock, key);
+}
+
+int app_trace_summary_get(enum app_trace_phase phase,
+			  struct app_trace_summary *summary)
+{
+	k_spinlock_key_t key;
+
+	if (phase >= APP_TRACE_PHASE_COUNT) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&lock);
+	*summary = phases[phase].summary;
+	k_spin_unlock(&lock, key);
+
+	summary->name = phase_names[phase];
+
+	return 0;
+}
+
+/* Markers written while iterating may show up out of order. */
+static void markers_foreach(void (*cb)(const struct marker *marker,
+				       void *user_data),
+			    void *user_data)
+{
+	u32_t end = (u32_t)atomic_get(&head);
+	u32_t start = end > CONFIG_APP_TRACE_BUFFER_SIZE ?
+		      end - CONFIG_APP_TRACE_BUFFER_SIZE : 0;
+
+	for (u32_t i = start; i != end; i++) {
+		cb(&ring[i & (CONFIG_APP_TRACE_BUFFER_SIZE - 1)], user_data);
+	}
+}
+
+static void marker_print(const struct marker *marker, void *user_data)
+{
+	printk("app_trace: %u %s %c\n", marker->cycles,
+	       phase_names[marker->phase], marker->end ? 'E' : 'B');
+}
+
+void app_trace_dump(void)
+{
+	printk("app_trace: hz %u\n", sys_clock_hw_cycles_per_sec());
+	markers_foreach(marker_print, NULL);
+}
+
+void app_trace_summary_log(void)
+{
+	struct app_trace_summary summary;
+
+	for (size_t i = 0; i < APP_TRACE_PHASE_COUNT; i++) {
+		app_trace_summary_get(i, &summary);
+
+		if (summary.count == 0) {
+			continue;
+		}
+
+		LOG_INF("%s: count %d, min %d us, avg %d us, max %d us",
+			log_strdup(summary.name), summary.count,
+			summary.min_us, (u32_t)(summary.sum_us / summary.count),
+			summary.max_us);
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static void marker_shell_print(const struct marker *marker, void *user_data)
+{
+	const struct shell *shell = user_data;
+
+	shell_print(shell, "app_trace: %u %s %c", marker->cycles,
+		    phase_names[marker->phase], marker->end ? 'E' : 'B');
+}
+
+static int cmd_dump(const struct shell *shell, size_t argc, char **argv)
+{
+	shell_print(shell, "app_trace: hz %u", sys_clock_hw_cycles_per_sec());
+	markers_foreach(marker_shell_print, (void *)shell);
+
+	return 0;
+}
+
+static int cmd_summary(const struct shell *shell, size_t argc, char **argv)
+{
+	struct app_trace_summary summary;
+
+	shell_print(shell, "%-14s %8s %10s %10s %10s", "phase", "count",
+		    "min us", "avg us", "max us");
+
+	for (size_t i = 0; i < APP_TRACE_PHASE_COUNT; i++) {
+		app_trace_summary_get(i, &summary);
+
+		shell_print(shell, "%-14s %8u %10u %10u %10u", summary.name,
+			    summary.count, summary.min_us,
+			    summary.count ?
+			    (u32_t)(summary.sum_us / summary.count) : 0,
+			    summary.max_us);
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_app_trace,
+	SHELL_CMD(dump, NULL, "Print the trace markers", cmd_dump),
+	SHELL_CMD(summary, NULL, "Print per-phase latencies", cmd_summary),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(app_trace, &sub_app_trace, "Wake cycle phase tracing",
+		   NULL);
+#endif /* CONFIG_SHELL */
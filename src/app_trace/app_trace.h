@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef APP_TRACE_H__
+#define APP_TRACE_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Traced phases of a wake cycle. */
+enum app_trace_phase {
+	APP_TRACE_GPS_SEARCH,
+	APP_TRACE_MODEM_INFO,
+	APP_TRACE_ENCODE,
+	APP_TRACE_CLOUD_SEND,
+	APP_TRACE_CLOUD_INPUT,
+	APP_TRACE_LED,
+	APP_TRACE_NETWORK_TIME,
+	APP_TRACE_NTP,
+
+	APP_TRACE_PHASE_COUNT
+};
+
+struct app_trace_summary {
+	const char *name;
+	u32_t count;
+	/** Durations in microseconds. */
+	u32_t min_us;
+	u32_t max_us;
+	u64_t sum_us;
+};
+
+#if defined(CONFIG_APP_TRACE)
+void app_trace_begin(enum app_trace_phase phase);
+void app_trace_end(enum app_trace_phase phase);
+
+/**
+ * @brief Gets the latency statistics of a phase.
+ *
+ * @return 0 on success, -EINVAL if the phase is invalid.
+ */
+int app_trace_summary_get(enum app_trace_phase phase,
+			  struct app_trace_summary *summary);
+
+/**
+ * @brief Prints the markers in the ring buffer, oldest first.
+ *
+ * The output is the input format of scripts/app_trace_histogram.py.
+ */
+void app_trace_dump(void);
+
+/**
+ * @brief Logs the latency statistics of all phases.
+ */
+void app_trace_summary_log(void);
+
+#define APP_TRACE_BEGIN(phase) app_trace_begin(phase)
+#define APP_TRACE_END(phase) app_trace_end(phase)
+#else
+#define APP_TRACE_BEGIN(phase) do { } while (0)
+#define APP_TRACE_END(phase) do { } while (0)
+#endif /* CONFIG_APP_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* APP_TRACE_H__ */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+
+#include "boot_seq.h"
+#include <metrics.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(boot_seq, CONFIG_BOOT_SEQ_LOG_LEVEL);
+
+static const char * const phase_names[] = {
+	[BOOT_PHASE_INIT] = "init",
+	[BOOT_PHASE_LTE_REGISTERED] = "lte_registered",
+	[BOOT_PHASE_LTE_IDLE] = "lte_idle",
+	[BOOT_PHASE_GPS_START] = "gps_start",
+	[BOOT_PHASE_FIRST_FIX] = "first_fix",
+	[BOOT_PHASE_CLOUD_CONNECTED] = "cloud_connected",
+	[BOOT_PHASE_FIRST_PUBLISH] = "first_publish",
+};
+
+BUILD_ASSERT_MSG(ARRAY_SIZE(phase_names) == BOOT_PHASE_COUNT,
+		 "Missing phase name");
+
+static s64_t phase_times[BOOT_PHASE_COUNT];
+static struct k_sem phase_sems[BOOT_PHASE_COUNT];
+
+static struct k_spinlock lock;
+
+void boot_seq_init(void)
+{
+	for (size_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		phase_times[i] = -1;
+		k_sem_init(&phase_sems[i], 0, 1);
+	}
+}
+
+void boot_seq_mark(enum boot_phase phase)
+{
+	s64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+	bool first;
+
+	key = k_spin_lock(&lock);
+	first = phase_times[phase] < 0;
+	if (first) {
+		phase_times[phase] = now;
+	}
+	k_spin_unlock(&lock, key);
+
+	if (!first) {
+		return;
+	}
+
+	LOG_INF("Boot phase %s reached after %d ms", phase_names[phase],
+		(s32_t)now);
+
+	k_sem_give(&phase_sems[phase]);
+
+	if (phase == BOOT_PHASE_FIRST_FIX) {
+		metrics_gauge_set(METRICS_BOOT_FIRST_FIX, now);
+	} else if (phase == BOOT_PHASE_FIRST_PUBLISH) {
+		metrics_gauge_set(METRICS_BOOT_FIRST_PUBLISH, now);
+		boot_seq_report();
+	}
+}
+
+int boot_seq_wait(enum boot_phase phase, s32_t timeout)
+{
+	if (k_sem_take(&phase_sems[phase], timeout)) {
+		return -EAGAIN;
+	}
+
+	/* Leave the semaphore given for other waiters. */
+	k_sem_give(&phase_sems[phase]);
+
+	return 0;
+}
+
+s64_t boot_seq_time_get(enum boot_phase phase)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	s64_t time = phase_times[phase];
+
+	k_spin_unlock(&lock, key);
+
+	return time;
+}
+
+void boot_seq_report(void)
+{
+	for (size_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		s64_t time = boot_seq_time_get(i);
+
+		if (time < 0) {
+			LOG_INF("%-16s not reached", phase_names[i]);
+		} else {
+			LOG_INF("%-16s %d ms", phase_names[i], (s32_t)time);
+		}
+	}
+}
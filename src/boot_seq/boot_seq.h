@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef BOOT_SEQ_H__
+#define BOOT_SEQ_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Milestones of the boot sequence, in their usual order. */
+enum boot_phase {
+	BOOT_PHASE_INIT,
+	BOOT_PHASE_LTE_REGISTERED,
+	BOOT_PHASE_LTE_IDLE,
+	BOOT_PHASE_GPS_START,
+	BOOT_PHASE_FIRST_FIX,
+	BOOT_PHASE_CLOUD_CONNECTED,
+	BOOT_PHASE_FIRST_PUBLISH,
+
+	BOOT_PHASE_COUNT
+};
+
+/**
+ * @brief Initializes the boot sequence. Must be called before any phase
+ *	  is marked.
+ */
+void boot_seq_init(void);
+
+/**
+ * @brief Records the uptime at which a phase was first reached and wakes
+ *	  up threads waiting for it. Later calls for the same phase are
+ *	  ignored.
+ */
+void boot_seq_mark(enum boot_phase phase);
+
+/**
+ * @brief Waits until a phase has been reached.
+ *
+ * @param timeout Time to wait in milliseconds, or K_FOREVER.
+ *
+ * @return 0 when the phase has been reached, -EAGAIN on timeout.
+ */
+int boot_seq_wait(enum boot_phase phase, s32_t timeout);
+
+/**
+ * @brief Returns the uptime in milliseconds at which a phase was reached,
+ *	  or -1 if it has not been reached.
+ */
+s64_t boot_seq_time_get(enum boot_phase phase);
+
+/**
+ * @brief Logs the time of each phase reached so far.
+ */
+void boot_seq_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BOOT_SEQ_H__ */
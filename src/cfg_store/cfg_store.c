@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <string.h>
+#include <settings/settings.h>
+#include <event_bus.h>
+
+#include "cfg_store.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cfg_store, CONFIG_CFG_STORE_LOG_LEVEL);
+
+#define SETTINGS_ROOT	"cfg"
+#define VERSION_KEY	"ver"
+#define KEY_LEN_MAX	8
+
+#define CFG_FIELD(_name, _member)					\
+	{								\
+		.name = _name,						\
+		.offset = offsetof(struct cloud_data, _member),		\
+		.size = sizeof(((struct cloud_data *)0)->_member)	\
+	}
+
+struct cfg_field {
+	const char *name;
+	size_t offset;
+	size_t size;
+};
+
+
+/* Stored under the same keys as in the shadow. */
+static const struct cfg_field fields[] = {
+	CFG_FIELD("gpst", gps_timeout),
+	CFG_FIELD("act", active),
+	CFG_FIELD("actwt", active_wait),
+	CFG_FIELD("mvres", passive_wait),
+	CFG_FIELD("mvt", movement_timeout),
+	CFG_FIELD("acct", accel_threshold),
+};
+
+static struct cloud_data *cfg;
+/* Values as last written to or read from flash. */
+static struct cloud_data stored;
+/* Shadow version of the configuration, kept for diagnostics only. It is
+ * not passed on to cfg_version, as the geofences are not stored: the first
+ * full shadow document after boot must be applied even if its version
+ * matches.
+ */
+static u32_t version;
+static u32_t stored_version;
+
+static struct k_delayed_work save_work;
+K_MUTEX_DEFINE(store_lock);
+
+static void *field_get(struct cloud_data *data, const struct cfg_field *field)
+{
+	return (u8_t *)data + field->offset;
+}
+
+static int settings_set(const char *key, size_t len, settings_read_cb read_cb,
+			void *cb_arg)
+{
+	void *value = NULL;
+	size_t size = 0;
+
+	if (strcmp(key, VERSION_KEY) == 0) {
+		value = &stored_version;
+		size = sizeof(stored_version);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(fields) && value == NULL; i++) {
+		if (strcmp(key, fields[i].name) == 0) {
+			value = field_get(cfg, &fields[i]);
+			size = fields[i].size;
+		}
+	}
+
+	if (value == NULL) {
+		return -ENOENT;
+	}
+
+	if (len != size) {
+		LOG_WRN("Ignoring %s with length %d", log_strdup(key), len);
+		return -EINVAL;
+	}
+
+	if (read_cb(cb_arg, value, size) != (ssize_t)size) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int save(void)
+{
+	char key[sizeof(SETTINGS_ROOT "/") + KEY_LEN_MAX];
+	int written = 0;
+	int err = 0;
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(fields); i++) {
+		void *value = field_get(cfg, &fields[i]);
+
+		if (memcmp(value, field_get(&stored, &fields[i]),
+			   fields[i].size) == 0) {
+			continue;
+		}
+
+		snprintf(key, sizeof(key), SETTINGS_ROOT "/%s",
+			 fields[i].name);
+
+		err = settings_save_one(key, value, fields[i].size);
+		if (err) {
+			break;
+		}
+
+		memcpy(field_get(&stored, &fields[i]), value, fields[i].size);
+		written++;
+	}
+
+	if (!err && version != stored_version) {
+		err = settings_save_one(SETTINGS_ROOT "/" VERSION_KEY, &version,
+					sizeof(version));
+		if (!err) {
+			stored_version = version;
+			written++;
+		}
+	}
+
+	k_mutex_unlock(&store_lock);
+
+	if (err) {
+		LOG_ERR("Could not write configuration, error: %d", err);
+	} else if (written) {
+		LOG_INF("%d configuration value(s) written", written);
+	}
+
+	return err;
+}
+
+static void save_work_fn(struct k_work *work)
+{
+	save();
+}
+
+int cfg_store_init(struct cloud_data *data)
+{
+	static struct settings_handler handler = {
+		.name = SETTINGS_ROOT,
+		.h_set = settings_set,
+	};
+	int err;
+
+	cfg = data;
+	k_delayed_work_init(&save_work, save_work_fn);
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("settings_subsys_init, error: %d", err);
+		return err;
+	}
+
+	err = settings_register(&handler);
+	if (err) {
+		LOG_ERR("settings_register, error: %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree(SETTINGS_ROOT);
+	if (err) {
+		LOG_ERR("settings_load_subtree, error: %d", err);
+		return err;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(fields); i++) {
+		memcpy(field_get(&stored, &fields[i]),
+		       field_get(cfg, &fields[i]), fields[i].size);
+	}
+
+	version = stored_version;
+
+	LOG_INF("Configuration loaded, shadow version %d", version);
+
+	return 0;
+}
+
+void cfg_store_update(void)
+{
+	if (cfg->cfg_version != 0) {
+		k_mutex_lock(&store_lock, K_FOREVER);
+		version = cfg->cfg_version;
+		k_mutex_unlock(&store_lock);
+	}
+
+	k_delayed_work_submit(&save_work,
+			      K_SECONDS(CONFIG_CFG_STORE_SAVE_DELAY));
+}
+
+static void cfg_updated_handler(const struct event_bus_evt *evt)
+{
+	cfg_store_update();
+}
+
+EVENT_BUS_SUBSCRIBE(cfg_store_cfg_updated, EVENT_BUS_CFG_UPDATED,
+		    cfg_updated_handler);
+
+int cfg_store_flush(void)
+{
+	k_delayed_work_cancel(&save_work);
+
+	return save();
+}
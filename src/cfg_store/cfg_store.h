@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef CFG_STORE_H__
+#define CFG_STORE_H__
+
+#include <zephyr.h>
+#include <cloud_codec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_CFG_STORE)
+/**
+ * @brief Loads the stored configuration into the configuration fields of
+ *	  cfg.
+ *
+ * @param cfg Configuration to persist. Must be valid for the lifetime of
+ *	      the application.
+ *
+ * @return 0 on success, otherwise a negative error code. The defaults in
+ *	   cfg are kept on failure.
+ */
+int cfg_store_init(struct cloud_data *cfg);
+
+/**
+ * @brief Schedules a write of the configuration fields that differ from
+ *	  the stored values, and records the shadow version of cfg.
+ *
+ * Calls within CONFIG_CFG_STORE_SAVE_DELAY are written together.
+ */
+void cfg_store_update(void);
+
+/**
+ * @brief Writes pending changes immediately.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int cfg_store_flush(void);
+
+#else
+static inline int cfg_store_init(struct cloud_data *cfg)
+{
+	return 0;
+}
+
+static inline void cfg_store_update(void)
+{
+}
+
+static inline int cfg_store_flush(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_CFG_STORE */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CFG_STORE_H__ */
@@ -10,6 +10,11 @@
 #include "cJSON_os.h"
 #include <net/cloud.h>
 #include <nrf9160_timestamp.h>
+#include <mem_track.h>
+#include <metrics.h>
+#if defined(CONFIG_GEOFENCE)
+#include <geofence.h>
+#endif
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(cloud_codec, CONFIG_CAT_TRACKER_LOG_LEVEL);
@@ -21,10 +26,92 @@ static bool change_passive_wait = true;
 static bool change_movement_timeout = true;
 static bool change_accel_threshold = true;
 
-struct twins_gps_buf {
-	cJSON *gps_buf_objects;
-	cJSON *gps_buf_val_objects;
-};
+/* Encoded messages are printed into fixed-size buffers, so that the
+ * publish path does not fragment the heap.
+ */
+K_MEM_SLAB_DEFINE(msg_buf_slab, CONFIG_AWS_IOT_MQTT_PAYLOAD_BUFFER_LEN,
+		  CONFIG_CLOUD_CODEC_MSG_BUF_COUNT, 4);
+
+#if CONFIG_CLOUD_CODEC_NODE_COUNT > 0
+/* Small cJSON allocations, nodes and object keys, are served from a slab.
+ * Larger allocations, and allocations when the slab is exhausted, fall
+ * back to the heap.
+ */
+K_MEM_SLAB_DEFINE(node_slab, CONFIG_CLOUD_CODEC_NODE_SIZE,
+		  CONFIG_CLOUD_CODEC_NODE_COUNT, 4);
+
+static bool is_node(const void *ptr)
+{
+	const char *p = ptr;
+
+	return p >= node_slab.buffer &&
+	       p < node_slab.buffer + node_slab.num_blocks *
+				      node_slab.block_size;
+}
+#endif
+
+/* cJSON allocations are accounted to the codec operation in progress.
+ * Decoding and encoding run in different threads, so an allocation is
+ * occasionally accounted to the wrong codec site.
+ */
+static enum mem_track_site codec_site = MEM_TRACK_SITE_CODEC_TREE;
+
+static void *codec_malloc(size_t size)
+{
+#if CONFIG_CLOUD_CODEC_NODE_COUNT > 0
+	void *ptr;
+
+	if (size <= CONFIG_CLOUD_CODEC_NODE_SIZE &&
+	    k_mem_slab_alloc(&node_slab, &ptr, K_NO_WAIT) == 0) {
+		return ptr;
+	}
+#endif
+	return mem_track_malloc(codec_site, size);
+}
+
+static void codec_free(void *ptr)
+{
+#if CONFIG_CLOUD_CODEC_NODE_COUNT > 0
+	if (is_node(ptr)) {
+		k_mem_slab_free(&node_slab, &ptr);
+		return;
+	}
+#endif
+	mem_track_free(ptr);
+}
+
+/* Prints the message into a message buffer. Running out of buffers is
+ * reported as -ENOBUFS, so that the caller can retry later.
+ */
+static int json_print_msg(cJSON *root, struct cloud_msg *output)
+{
+	void *buffer;
+
+	if (k_mem_slab_alloc(&msg_buf_slab, &buffer, K_NO_WAIT)) {
+		LOG_WRN("No free message buffer");
+		metrics_counter_inc(METRICS_ENCODE_FAILED);
+		return -ENOBUFS;
+	}
+
+	if (!cJSON_PrintPreallocated(root, buffer,
+				     CONFIG_AWS_IOT_MQTT_PAYLOAD_BUFFER_LEN,
+				     true)) {
+		LOG_ERR("Message does not fit in %d bytes",
+			CONFIG_AWS_IOT_MQTT_PAYLOAD_BUFFER_LEN);
+		k_mem_slab_free(&msg_buf_slab, &buffer);
+		metrics_counter_inc(METRICS_ENCODE_FAILED);
+		return -EMSGSIZE;
+	}
+
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_PRINT_PAYLOAD)) {
+		printk("Encoded message: %s\n", (char *)buffer);
+	}
+
+	output->buf = buffer;
+	output->len = strlen(buffer);
+
+	return 0;
+}
 
 static int json_add_obj(cJSON *parent, const char *str, cJSON *item)
 {
@@ -64,7 +151,8 @@ static int json_add_bool(cJSON *parent, const char *str, int item)
 	return json_add_obj(parent, str, json_bool);
 }
 
-static int json_add_DoubleArray(cJSON *parent, const char *str, double *item)
+static int json_add_DoubleArray(cJSON *parent, const char *str,
+				const double *item)
 {
 	cJSON *json_double;
 
@@ -81,6 +169,53 @@ static cJSON *json_object_decode(cJSON *obj, const char *str)
 	return obj ? cJSON_GetObjectItem(obj, str) : NULL;
 }
 
+#define VERSION_KEY "\"version\""
+#define VERSION_KEY_LEN (sizeof(VERSION_KEY) - 1)
+
+/* Finds the shadow version without parsing the message. The version is
+ * the last member of shadow documents, and no configuration key is named
+ * "version", so the last occurrence is the top-level one.
+ */
+static int version_scan(const char *input, u32_t *version)
+{
+	const char *found = NULL;
+	const char *pos = input;
+	char *end;
+
+	while ((pos = strstr(pos, VERSION_KEY)) != NULL) {
+		found = pos;
+		pos += VERSION_KEY_LEN;
+	}
+
+	if (found == NULL) {
+		return -ENOENT;
+	}
+
+	found += VERSION_KEY_LEN;
+	while (*found == ' ' || *found == ':') {
+		found++;
+	}
+
+	*version = strtoul(found, &end, 10);
+	if (end == found) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Sets the value and reports whether it changed. */
+static bool cfg_value_set(int *value, const cJSON *item)
+{
+	if (item == NULL || *value == item->valueint) {
+		return false;
+	}
+
+	*value = item->valueint;
+
+	return true;
+}
+
 static int json_add_str(cJSON *parent, const char *str, const char *item)
 {
 	cJSON *json_str;
@@ -93,9 +228,114 @@ static int json_add_str(cJSON *parent, const char *str, const char *item)
 	return json_add_obj(parent, str, json_str);
 }
 
+#if defined(CONFIG_GEOFENCE)
+static int json_decode_point(cJSON *lat, cJSON *lng,
+			     struct geofence_point *point)
+{
+	if (!cJSON_IsNumber(lat) || !cJSON_IsNumber(lng)) {
+		return -EINVAL;
+	}
+
+	point->lat = (s32_t)(lat->valuedouble * 1000000);
+	point->lng = (s32_t)(lng->valuedouble * 1000000);
+
+	return 0;
+}
+
+/* Fences are given as
+ * "fences": [{"id": 1, "home": true, "c": [lat, lng, radius]},
+ *	      {"id": 2, "p": [[lat, lng], [lat, lng], [lat, lng]]}]
+ */
+static int json_decode_fences(cJSON *fences_obj)
+{
+	static struct geofence fences[CONFIG_GEOFENCE_MAX_FENCES];
+	int count = cJSON_GetArraySize(fences_obj);
+	int err;
+
+	if (!cJSON_IsArray(fences_obj) || count > (int)ARRAY_SIZE(fences)) {
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < count; i++) {
+		cJSON *fence_obj = cJSON_GetArrayItem(fences_obj, i);
+		cJSON *id = cJSON_GetObjectItem(fence_obj, "id");
+		cJSON *home = cJSON_GetObjectItem(fence_obj, "home");
+		cJSON *circle = cJSON_GetObjectItem(fence_obj, "c");
+		cJSON *polygon = cJSON_GetObjectItem(fence_obj, "p");
+		cJSON *radius = cJSON_GetArrayItem(circle, 2);
+		struct geofence *fence = &fences[i];
+
+		if (!cJSON_IsNumber(id) || id->valuedouble < 0 ||
+		    id->valuedouble > UINT8_MAX) {
+			return -EINVAL;
+		}
+
+		memset(fence, 0, sizeof(*fence));
+		fence->id = id->valueint;
+		fence->home = cJSON_IsTrue(home);
+
+		if (cJSON_IsArray(circle) && cJSON_GetArraySize(circle) == 3) {
+			if (!cJSON_IsNumber(radius) || radius->valuedouble < 1 ||
+			    radius->valuedouble > GEOFENCE_RADIUS_MAX) {
+				return -EINVAL;
+			}
+
+			fence->type = GEOFENCE_CIRCLE;
+			fence->radius = radius->valueint;
+			err = json_decode_point(cJSON_GetArrayItem(circle, 0),
+						cJSON_GetArrayItem(circle, 1),
+						&fence->center);
+			if (err) {
+				return err;
+			}
+		} else if (cJSON_IsArray(polygon) &&
+			   cJSON_GetArraySize(polygon) <=
+			   CONFIG_GEOFENCE_MAX_VERTICES) {
+			fence->type = GEOFENCE_POLYGON;
+			fence->vertex_cnt = cJSON_GetArraySize(polygon);
+
+			for (int j = 0; j < fence->vertex_cnt; j++) {
+				cJSON *vertex = cJSON_GetArrayItem(polygon, j);
+
+				err = json_decode_point(
+					cJSON_GetArrayItem(vertex, 0),
+					cJSON_GetArrayItem(vertex, 1),
+					&fence->vertices[j]);
+				if (err) {
+					return err;
+				}
+			}
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return geofence_set(fences, count);
+}
+#endif
+
+int cloud_codec_init(void)
+{
+	cJSON_Hooks hooks = {
+		.malloc_fn = codec_malloc,
+		.free_fn = codec_free,
+	};
+
+	cJSON_InitHooks(&hooks);
+
+	return 0;
+}
+
+void cloud_release_data(struct cloud_msg *data)
+{
+	void *buffer = data->buf;
+
+	k_mem_slab_free(&msg_buf_slab, &buffer);
+}
+
 int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 {
-	char *string = NULL;
+	void *string = NULL;
 	cJSON *root_obj = NULL;
 	cJSON *group_obj = NULL;
 	cJSON *subgroup_obj = NULL;
@@ -105,23 +345,49 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 	cJSON *passive_wait = NULL;
 	cJSON *movement_timeout = NULL;
 	cJSON *accel_threshold = NULL;
+	cJSON *fences = NULL;
+	cJSON *version = NULL;
+	struct cloud_data cfg;
+	u32_t scanned_version;
+	bool changed = false;
 
 	if (input == NULL) {
 		return -EINVAL;
 	}
 
+	/* Deltas carry "state", full documents from a get are the desired
+	 * "cfg" object alone. A full document with a lower version than the
+	 * applied one means that the shadow was recreated, so it is applied
+	 * and its version replaces the applied one. Only deltas, which may
+	 * arrive late or twice, are dropped for a lower version.
+	 */
+	if (!version_scan(input, &scanned_version) &&
+	    (scanned_version == cloud_data->cfg_version ||
+	     (scanned_version < cloud_data->cfg_version &&
+	      strstr(input, "\"state\"") != NULL))) {
+		LOG_DBG("Shadow version %d already applied", scanned_version);
+		metrics_counter_inc(METRICS_CFG_PARSES_AVOIDED);
+		return -EALREADY;
+	}
+
+	codec_site = MEM_TRACK_SITE_CODEC_DECODE;
 	root_obj = cJSON_Parse(input);
+	codec_site = MEM_TRACK_SITE_CODEC_TREE;
 	if (root_obj == NULL) {
 		return -ENOENT;
 	}
 
-	string = cJSON_Print(root_obj);
-	if (string == NULL) {
-		LOG_ERR("Failed to print message.");
-		goto exit;
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_PRINT_PAYLOAD) &&
+	    !k_mem_slab_alloc(&msg_buf_slab, &string, K_NO_WAIT)) {
+		if (cJSON_PrintPreallocated(root_obj, string,
+				CONFIG_AWS_IOT_MQTT_PAYLOAD_BUFFER_LEN, true)) {
+			printk("Decoded message: %s\n", (char *)string);
+		}
+
+		k_mem_slab_free(&msg_buf_slab, &string);
 	}
 
-	printk("Decoded message: %s\n", string);
+	version = cJSON_GetObjectItem(root_obj, "version");
 
 	group_obj = json_object_decode(root_obj, "cfg");
 	if (group_obj != NULL) {
@@ -131,6 +397,7 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 		passive_wait = cJSON_GetObjectItem(group_obj, "mvres");
 		movement_timeout = cJSON_GetObjectItem(group_obj, "mvt");
 		accel_threshold = cJSON_GetObjectItem(group_obj, "acct");
+		fences = cJSON_GetObjectItem(group_obj, "fences");
 		goto get_data;
 	}
 
@@ -148,6 +415,7 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 				cJSON_GetObjectItem(subgroup_obj, "mvt");
 			accel_threshold =
 				cJSON_GetObjectItem(subgroup_obj, "acct");
+			fences = cJSON_GetObjectItem(subgroup_obj, "fences");
 		}
 	} else {
 		goto exit;
@@ -155,58 +423,100 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 
 get_data:
 
-	if (gpst != NULL) {
-		cloud_data->gps_timeout = gpst->valueint;
-		LOG_INF("SETTING GPST TO: %d", gpst->valueint);
+	/* Decoded into a copy and applied at once, so that other threads
+	 * never see a partially applied configuration.
+	 */
+	cfg = *cloud_data;
+
+	if (version != NULL && cJSON_IsNumber(version)) {
+		if ((u32_t)version->valueint < cfg.cfg_version) {
+			LOG_WRN("Shadow version reset from %d to %d",
+				cfg.cfg_version, version->valueint);
+		}
+
+		cfg.cfg_version = version->valueint;
+	}
+
+	if (cfg_value_set(&cfg.gps_timeout, gpst)) {
+		LOG_INF("SETTING GPST TO: %d", cfg.gps_timeout);
 		change_gpst = true;
+		changed = true;
 	}
 
-	if (active != NULL) {
-		cloud_data->active = active->valueint;
-		LOG_INF("SETTING ACTIVE TO: %d", active->valueint);
+	if (active != NULL && cfg.active != (bool)active->valueint) {
+		cfg.active = active->valueint;
+		LOG_INF("SETTING ACTIVE TO: %d", cfg.active);
 		change_active = true;
+		changed = true;
 	}
 
-	if (active_wait != NULL) {
-		cloud_data->active_wait = active_wait->valueint;
-		LOG_INF("SETTING ACTIVE WAIT TO: %d", active_wait->valueint);
+	if (cfg_value_set(&cfg.active_wait, active_wait)) {
+		LOG_INF("SETTING ACTIVE WAIT TO: %d", cfg.active_wait);
 		change_active_wait = true;
+		changed = true;
 	}
 
-	if (passive_wait != NULL) {
-		cloud_data->passive_wait = passive_wait->valueint;
-		LOG_INF("SETTING PASSIVE_WAIT TO: %d", passive_wait->valueint);
+	if (cfg_value_set(&cfg.passive_wait, passive_wait)) {
+		LOG_INF("SETTING PASSIVE_WAIT TO: %d", cfg.passive_wait);
 		change_passive_wait = true;
+		changed = true;
 	}
 
-	if (movement_timeout != NULL) {
-		cloud_data->movement_timeout = movement_timeout->valueint;
+	if (cfg_value_set(&cfg.movement_timeout, movement_timeout)) {
 		LOG_INF("SETTING MOVEMENT TIMEOUT TO: %d",
-		       movement_timeout->valueint);
+		       cfg.movement_timeout);
 		change_movement_timeout = true;
+		changed = true;
 	}
 
-	if (accel_threshold != NULL) {
-		cloud_data->accel_threshold = accel_threshold->valueint;
+	if (cfg_value_set(&cfg.accel_threshold, accel_threshold)) {
 		LOG_INF("SETTING ACCEL THRESHOLD TIMEOUT TO: %d",
-		       accel_threshold->valueint);
+		       cfg.accel_threshold);
 		change_accel_threshold = true;
+		changed = true;
+	}
+
+	if (!changed) {
+		metrics_counter_inc(METRICS_CFG_REPORTS_AVOIDED);
+	}
+
+	k_sched_lock();
+	cloud_data->cfg_version = cfg.cfg_version;
+	cloud_data->gps_timeout = cfg.gps_timeout;
+	cloud_data->active = cfg.active;
+	cloud_data->active_wait = cfg.active_wait;
+	cloud_data->passive_wait = cfg.passive_wait;
+	cloud_data->movement_timeout = cfg.movement_timeout;
+	cloud_data->accel_threshold = cfg.accel_threshold;
+	k_sched_unlock();
+
+#if defined(CONFIG_GEOFENCE)
+	if (fences != NULL) {
+		int err = json_decode_fences(fences);
+
+		if (err) {
+			LOG_ERR("Could not decode fences, error: %d", err);
+		}
 	}
+#else
+	ARG_UNUSED(fences);
+#endif
 exit:
 	cJSON_Delete(root_obj);
 	return 0;
 }
 
 int cloud_encode_gps_buffer(struct cloud_msg *output,
-			    struct cloud_data_gps *cir_buf_gps)
+			    const struct cloud_data_gps *cir_buf_gps,
+			    u32_t *encoded)
 {
 	int err = 0;
-	char *buffer;
 	int encoded_counter = 0;
+	s64_t gps_timestamp = cir_buf_gps->gps_timestamp;
 
-	struct twins_gps_buf twins_gps_buf[CONFIG_CIRCULAR_SENSOR_BUFFER_MAX];
+	*encoded = 0;
 
-	err = date_time_get(&cir_buf_gps->gps_timestamp);
+	err = date_time_get(&gps_timestamp);
 	if (err) {
 		LOG_ERR("date_time_get, error: %d", err);
 		return err;
@@ -217,87 +527,79 @@ int cloud_encode_gps_buffer(struct cloud_msg *output,
 	cJSON *reported_obj = cJSON_CreateObject();
 	cJSON *gps_obj = cJSON_CreateArray();
 
-	for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX; i++) {
-		twins_gps_buf[i].gps_buf_objects = NULL;
-		twins_gps_buf[i].gps_buf_objects = cJSON_CreateObject();
-		twins_gps_buf[i].gps_buf_val_objects = NULL;
-		twins_gps_buf[i].gps_buf_val_objects = cJSON_CreateObject();
-	}
-
 	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
 	    gps_obj == NULL) {
 		cJSON_Delete(root_obj);
 		cJSON_Delete(state_obj);
 		cJSON_Delete(reported_obj);
 		cJSON_Delete(gps_obj);
-		for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX; i++) {
-			cJSON_Delete(twins_gps_buf[i].gps_buf_objects);
-			cJSON_Delete(twins_gps_buf[i].gps_buf_val_objects);
-		}
 		return -ENOMEM;
 	}
 
-	err += json_add_obj(reported_obj, "gps", gps_obj);
-	err += json_add_obj(state_obj, "reported", reported_obj);
-	err += json_add_obj(root_obj, "state", state_obj);
+	/* Objects are attached as soon as they are created, so that deleting
+	 * root_obj frees everything on any error.
+	 */
+	json_add_obj(reported_obj, "gps", gps_obj);
+	json_add_obj(state_obj, "reported", reported_obj);
+	json_add_obj(root_obj, "state", state_obj);
 
-	for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX; i++) {
-		if (cir_buf_gps[i].queued &&
-		    (encoded_counter < CONFIG_MAX_PER_ENCODED_ENTRIES)) {
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "lng",
-				cir_buf_gps[i].longitude);
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "lat",
-				cir_buf_gps[i].latitude);
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "acc",
-				cir_buf_gps[i].accuracy);
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "alt",
-				cir_buf_gps[i].altitude);
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "spd",
-				cir_buf_gps[i].speed);
-			err += json_add_number(
-				twins_gps_buf[i].gps_buf_val_objects, "hdg",
-				cir_buf_gps[i].heading);
-
-			err += json_add_obj(
-				twins_gps_buf[i].gps_buf_objects, "v",
-				twins_gps_buf[i].gps_buf_val_objects);
-			err += json_add_number(twins_gps_buf[i].gps_buf_objects,
-					       "ts", cir_buf_gps->gps_timestamp);
-			err += json_add_obj_array(
-				gps_obj, twins_gps_buf[i].gps_buf_objects);
-			cir_buf_gps[i].queued = false;
-			encoded_counter++;
+	for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX &&
+			encoded_counter < CONFIG_MAX_PER_ENCODED_ENTRIES; i++) {
+		cJSON *entry_obj;
+		cJSON *val_obj;
+
+		if (!cir_buf_gps[i].queued) {
+			continue;
 		}
-	}
 
-	encoded_counter = 0;
+		entry_obj = cJSON_CreateObject();
+		val_obj = cJSON_CreateObject();
+		if (entry_obj == NULL || val_obj == NULL) {
+			cJSON_Delete(entry_obj);
+			cJSON_Delete(val_obj);
+			err = -ENOMEM;
+			break;
+		}
+
+		json_add_obj_array(gps_obj, entry_obj);
+		json_add_obj(entry_obj, "v", val_obj);
+
+		err += json_add_number(val_obj, "lng",
+				       cir_buf_gps[i].longitude);
+		err += json_add_number(val_obj, "lat", cir_buf_gps[i].latitude);
+		err += json_add_number(val_obj, "acc", cir_buf_gps[i].accuracy);
+		err += json_add_number(val_obj, "alt", cir_buf_gps[i].altitude);
+		err += json_add_number(val_obj, "spd", cir_buf_gps[i].speed);
+		err += json_add_number(val_obj, "hdg", cir_buf_gps[i].heading);
+
+		if (cir_buf_gps[i].duration) {
+			err += json_add_number(val_obj, "dur",
+					       cir_buf_gps[i].duration);
+		}
+
+		err += json_add_number(entry_obj, "ts", gps_timestamp);
+		if (err) {
+			break;
+		}
+
+		*encoded |= BIT(i);
+		encoded_counter++;
+	}
 
 	if (err) {
 		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(gps_obj);
-		for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX; i++) {
-			cJSON_Delete(twins_gps_buf[i].gps_buf_objects);
-			cJSON_Delete(twins_gps_buf[i].gps_buf_val_objects);
-		}
+		*encoded = 0;
 		return -EAGAIN;
 	}
 
-	buffer = cJSON_Print(root_obj);
+	err = json_print_msg(root_obj, output);
 	cJSON_Delete(root_obj);
 
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	if (err) {
+		*encoded = 0;
+	}
 
-	return 0;
+	return err;
 }
 
 int cloud_encode_modem_data(struct cloud_msg *output,
@@ -306,7 +608,6 @@ int cloud_encode_modem_data(struct cloud_msg *output,
 			    bool include_dev_data, int rsrp)
 {
 	int err = 0;
-	char *buffer;
 
 	static const char lte_string[] = "LTE-M";
 	static const char nbiot_string[] = "NB-IoT";
@@ -390,12 +691,7 @@ int cloud_encode_modem_data(struct cloud_msg *output,
 		goto exit;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-	printk("Encoded message: %s\n", buffer);
+	err = json_print_msg(root_obj, output);
 
 exit:
 
@@ -417,7 +713,6 @@ int cloud_encode_cfg_data(struct cloud_msg *output,
 {
 	int err = 0;
 	int change_cnt = 0;
-	char *buffer;
 
 	cJSON *root_obj = cJSON_CreateObject();
 	cJSON *state_obj = cJSON_CreateObject();
@@ -486,12 +781,10 @@ int cloud_encode_cfg_data(struct cloud_msg *output,
 		goto exit;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	err = json_print_msg(root_obj, output);
+	if (err) {
+		goto exit;
+	}
 
 	change_gpst			= false;
 	change_active			= false;
@@ -506,25 +799,27 @@ exit:
 }
 
 int cloud_encode_sensor_data(struct cloud_msg *output,
-			     struct cloud_data *cloud_data,
-			     struct cloud_data_gps *cir_buf_gps)
+			     const struct cloud_data *cloud_data,
+			     const struct cloud_data_gps *cir_buf_gps)
 {
 	int err = 0;
-	char *buffer;
+	s64_t bat_timestamp = cloud_data->bat_timestamp;
+	s64_t acc_timestamp = cloud_data->acc_timestamp;
+	s64_t gps_timestamp = cir_buf_gps->gps_timestamp;
 
-	err = date_time_get(&cloud_data->bat_timestamp);
+	err = date_time_get(&bat_timestamp);
 	if (err) {
 		LOG_ERR("date_time_get, error: %d", err);
 		return err;
 	}
 
-	err = date_time_get(&cloud_data->acc_timestamp);
+	err = date_time_get(&acc_timestamp);
 	if (err) {
 		LOG_ERR("date_time_get, error: %d", err);
 		return err;
 	}
 
-	err = date_time_get(&cir_buf_gps->gps_timestamp);
+	err = date_time_get(&gps_timestamp);
 	if (err) {
 		LOG_ERR("date_time_get, error: %d", err);
 		return err;
@@ -553,11 +848,11 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 
 	/*BAT*/
 	err += json_add_number(bat_obj, "v", cloud_data->bat_voltage);
-	err += json_add_number(bat_obj, "ts", cloud_data->bat_timestamp);
+	err += json_add_number(bat_obj, "ts", bat_timestamp);
 
 	/*ACC*/
 	err += json_add_DoubleArray(acc_obj, "v", cloud_data->acc);
-	err += json_add_number(acc_obj, "ts", cloud_data->acc_timestamp);
+	err += json_add_number(acc_obj, "ts", acc_timestamp);
 
 	/*GPS*/
 	err += json_add_number(gps_val_obj, "lng", cir_buf_gps->longitude);
@@ -567,6 +862,11 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 	err += json_add_number(gps_val_obj, "spd", cir_buf_gps->speed);
 	err += json_add_number(gps_val_obj, "hdg", cir_buf_gps->heading);
 
+	if (cir_buf_gps->duration) {
+		err += json_add_number(gps_val_obj, "dur",
+				       cir_buf_gps->duration);
+	}
+
 	/*Parameters included depending on mode and obtained gps fix*/
 	if (cloud_data->active && !cloud_data->gps_found) {
 		err += json_add_obj(reported_obj, "bat", bat_obj);
@@ -575,7 +875,7 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 	if (cloud_data->active && cloud_data->gps_found) {
 		err += json_add_obj(reported_obj, "bat", bat_obj);
 		err += json_add_obj(gps_obj, "v", gps_val_obj);
-		err += json_add_number(gps_obj, "ts", cir_buf_gps->gps_timestamp);
+		err += json_add_number(gps_obj, "ts", gps_timestamp);
 		err += json_add_obj(reported_obj, "gps", gps_obj);
 	}
 
@@ -588,7 +888,7 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 		err += json_add_obj(reported_obj, "bat", bat_obj);
 		err += json_add_obj(reported_obj, "acc", acc_obj);
 		err += json_add_obj(gps_obj, "v", gps_val_obj);
-		err += json_add_number(gps_obj, "ts", cir_buf_gps->gps_timestamp);
+		err += json_add_number(gps_obj, "ts", gps_timestamp);
 		err += json_add_obj(reported_obj, "gps", gps_obj);
 	}
 
@@ -599,12 +899,7 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 		goto exit;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	err = json_print_msg(root_obj, output);
 
 exit:
 	cJSON_Delete(root_obj);
@@ -631,3 +926,142 @@ exit:
 
 	return err;
 }
+
+#if defined(CONFIG_GEOFENCE)
+int cloud_encode_geofence_event(struct cloud_msg *output,
+				const struct geofence_event *evt)
+{
+	int err = 0;
+	s64_t timestamp = evt->timestamp;
+
+	err = date_time_get(&timestamp);
+	if (err) {
+		LOG_ERR("date_time_get, error: %d", err);
+		return err;
+	}
+
+	cJSON *root_obj = cJSON_CreateObject();
+	cJSON *state_obj = cJSON_CreateObject();
+	cJSON *reported_obj = cJSON_CreateObject();
+	cJSON *geo_obj = cJSON_CreateObject();
+	cJSON *geo_val_obj = cJSON_CreateObject();
+
+	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
+	    geo_obj == NULL || geo_val_obj == NULL) {
+		cJSON_Delete(root_obj);
+		cJSON_Delete(state_obj);
+		cJSON_Delete(reported_obj);
+		cJSON_Delete(geo_obj);
+		cJSON_Delete(geo_val_obj);
+		return -ENOMEM;
+	}
+
+	err += json_add_number(geo_val_obj, "id", evt->id);
+	err += json_add_bool(geo_val_obj, "in", evt->inside);
+	err += json_add_number(geo_val_obj, "lng", evt->longitude);
+	err += json_add_number(geo_val_obj, "lat", evt->latitude);
+
+	err += json_add_obj(geo_obj, "v", geo_val_obj);
+	err += json_add_number(geo_obj, "ts", timestamp);
+	err += json_add_obj(reported_obj, "geo", geo_obj);
+	err += json_add_obj(state_obj, "reported", reported_obj);
+	err += json_add_obj(root_obj, "state", state_obj);
+
+	if (err) {
+		goto exit;
+	}
+
+	err = json_print_msg(root_obj, output);
+
+exit:
+	cJSON_Delete(root_obj);
+	return err;
+}
+#endif
+
+#if defined(CONFIG_METRICS)
+static int json_add_histogram(cJSON *parent, const char *str,
+			      const u16_t *buckets)
+{
+	int values[METRICS_HISTOGRAM_BUCKETS];
+	cJSON *array;
+
+	for (size_t i = 0; i < ARRAY_SIZE(values); i++) {
+		values[i] = buckets[i];
+	}
+
+	array = cJSON_CreateIntArray(values, ARRAY_SIZE(values));
+	if (array == NULL) {
+		return -ENOMEM;
+	}
+
+	return json_add_obj(parent, str, array);
+}
+
+int cloud_encode_metrics(struct cloud_msg *output,
+			 const struct metrics_snapshot *snapshot)
+{
+	int err = 0;
+	s64_t timestamp = k_uptime_get();
+
+	err = date_time_get(&timestamp);
+	if (err) {
+		LOG_ERR("date_time_get, error: %d", err);
+		return err;
+	}
+
+	cJSON *root_obj = cJSON_CreateObject();
+	cJSON *state_obj = cJSON_CreateObject();
+	cJSON *reported_obj = cJSON_CreateObject();
+	cJSON *metrics_obj = cJSON_CreateObject();
+	cJSON *metrics_val_obj = cJSON_CreateObject();
+
+	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
+	    metrics_obj == NULL || metrics_val_obj == NULL) {
+		cJSON_Delete(root_obj);
+		cJSON_Delete(state_obj);
+		cJSON_Delete(reported_obj);
+		cJSON_Delete(metrics_obj);
+		cJSON_Delete(metrics_val_obj);
+		return -ENOMEM;
+	}
+
+	for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+		err += json_add_number(metrics_val_obj,
+				       metrics_counter_name(i),
+				       snapshot->counters[i]);
+	}
+
+	for (size_t i = 0; i < METRICS_GAUGE_COUNT; i++) {
+		err += json_add_number(metrics_val_obj, metrics_gauge_name(i),
+				       snapshot->gauges[i]);
+	}
+
+	for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+		err += json_add_histogram(metrics_val_obj,
+					  metrics_histogram_name(i),
+					  snapshot->histograms[i]);
+	}
+
+	err += json_add_number(metrics_val_obj, "rbt", snapshot->reboot_reason);
+	err += json_add_number(metrics_val_obj, "rbtCnt",
+			       snapshot->reboot_count);
+	err += json_add_number(metrics_val_obj, "up", snapshot->uptime);
+
+	err += json_add_obj(metrics_obj, "v", metrics_val_obj);
+	err += json_add_number(metrics_obj, "ts", timestamp);
+	err += json_add_obj(reported_obj, "metrics", metrics_obj);
+	err += json_add_obj(state_obj, "reported", reported_obj);
+	err += json_add_obj(root_obj, "state", state_obj);
+
+	if (err) {
+		goto exit;
+	}
+
+	err = json_print_msg(root_obj, output);
+
+exit:
+	cJSON_Delete(root_obj);
+	return err;
+}
+#endif
@@ -21,6 +21,7 @@ struct cloud_data_gps {
 	float speed;
 	float heading;
 	s64_t gps_timestamp;
+	u32_t duration;
 	bool queued;
 };
 
@@ -37,6 +38,8 @@ struct cloud_data {
 	int passive_wait;
 	int movement_timeout;
 	int accel_threshold;
+	/* Shadow version of the last received configuration, 0 if none. */
+	u32_t cfg_version;
 
 	bool gps_found;
 
@@ -50,14 +53,29 @@ struct cloud_data_time {
 	s64_t delta_time;
 };
 
+int cloud_codec_init(void);
+
 int cloud_decode_response(char *input, struct cloud_data *cloud_data);
 
 int cloud_encode_sensor_data(struct cloud_msg *output,
-			     struct cloud_data *cloud_data,
-			     struct cloud_data_gps *cir_buf_gps);
-
+			     const struct cloud_data *cloud_data,
+			     const struct cloud_data_gps *cir_buf_gps);
+
+/**
+ * @brief Encodes up to CONFIG_MAX_PER_ENCODED_ENTRIES queued entries of
+ *	  the GPS buffer. The entries are left queued, so that they are
+ *	  kept if the message cannot be sent.
+ *
+ * @param output Encoded message.
+ * @param cir_buf_gps GPS buffer of CONFIG_CIRCULAR_SENSOR_BUFFER_MAX
+ *		      entries.
+ * @param encoded Set to a bitmask of the encoded entries, 0 on error.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
 int cloud_encode_gps_buffer(struct cloud_msg *output,
-			    struct cloud_data_gps *cir_buf_gps);
+			    const struct cloud_data_gps *cir_buf_gps,
+			    u32_t *encoded);
 
 int cloud_encode_modem_data(struct cloud_msg *output,
 			    struct cloud_data *cloud_data,
@@ -67,10 +85,21 @@ int cloud_encode_modem_data(struct cloud_msg *output,
 int cloud_encode_cfg_data(struct cloud_msg *output,
 			  struct cloud_data *cloud_data);
 
-static inline void cloud_release_data(struct cloud_msg *data)
-{
-	free(data->buf);
-}
+#if defined(CONFIG_GEOFENCE)
+struct geofence_event;
+
+int cloud_encode_geofence_event(struct cloud_msg *output,
+				const struct geofence_event *evt);
+#endif
+
+#if defined(CONFIG_METRICS)
+struct metrics_snapshot;
+
+int cloud_encode_metrics(struct cloud_msg *output,
+			 const struct metrics_snapshot *snapshot);
+#endif
+
+void cloud_release_data(struct cloud_msg *data);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "event_bus.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(event_bus, CONFIG_EVENT_BUS_LOG_LEVEL);
+
+static const char * const type_names[] = {
+	[EVENT_BUS_MOTION] = "motion",
+	[EVENT_BUS_GPS_FIX] = "gps_fix",
+	[EVENT_BUS_CFG_UPDATED] = "cfg_updated",
+};
+
+BUILD_ASSERT_MSG(ARRAY_SIZE(type_names) == EVENT_BUS_TYPE_COUNT,
+		 "Missing event type name");
+
+K_MSGQ_DEFINE(event_msgq, sizeof(struct event_bus_evt),
+	      CONFIG_EVENT_BUS_QUEUE_SIZE, 4);
+
+static struct event_bus_stats stats[EVENT_BUS_TYPE_COUNT];
+static struct k_spinlock lock;
+
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC);
+}
+
+int event_bus_publish(struct event_bus_evt *evt)
+{
+	k_spinlock_key_t key;
+
+	__ASSERT_NO_MSG(evt->type < EVENT_BUS_TYPE_COUNT);
+
+	evt->cycles = k_cycle_get_32();
+
+	if (k_msgq_put(&event_msgq, evt, K_NO_WAIT) == 0) {
+		return 0;
+	}
+
+	key = k_spin_lock(&lock);
+	stats[evt->type].dropped++;
+	k_spin_unlock(&lock, key);
+
+	return -ENOMEM;
+}
+
+static void dispatch(const struct event_bus_evt *evt)
+{
+	u32_t start = k_cycle_get_32();
+	u32_t latency_us = cycles_to_us(start - evt->cycles);
+	u32_t handling_us;
+	k_spinlock_key_t key;
+
+	Z_STRUCT_SECTION_FOREACH(event_bus_subscriber, sub) {
+		if (sub->type == evt->type) {
+			sub->handler(evt);
+		}
+	}
+
+	handling_us = cycles_to_us(k_cycle_get_32() - start);
+
+	key = k_spin_lock(&lock);
+	stats[evt->type].count++;
+	stats[evt->type].latency_sum_us += latency_us;
+	stats[evt->type].latency_max_us =
+		MAX(stats[evt->type].latency_max_us, latency_us);
+	stats[evt->type].handling_max_us =
+		MAX(stats[evt->type].handling_max_us, handling_us);
+	k_spin_unlock(&lock, key);
+}
+
+static void event_bus_thread_fn(void)
+{
+	struct event_bus_evt evt;
+
+	while (true) {
+		k_msgq_get(&event_msgq, &evt, K_FOREVER);
+		dispatch(&evt);
+	}
+}
+
+K_THREAD_DEFINE(event_bus_thread, CONFIG_EVENT_BUS_STACK_SIZE,
+		event_bus_thread_fn, NULL, NULL, NULL,
+		CONFIG_EVENT_BUS_PRIORITY, 0, K_NO_WAIT);
+
+void event_bus_stats_get(enum event_bus_type type,
+			 struct event_bus_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*out = stats[type];
+
+	k_spin_unlock(&lock, key);
+
+	out->name = type_names[type];
+}
+
+void event_bus_report(void)
+{
+	struct event_bus_stats s;
+
+	for (size_t i = 0; i < EVENT_BUS_TYPE_COUNT; i++) {
+		event_bus_stats_get(i, &s);
+
+		LOG_INF("%s: count %d, dropped %d, latency avg %d us, "
+			"max %d us, handling max %d us", s.name, s.count,
+			s.dropped,
+			s.count ? (u32_t)(s.latency_sum_us / s.count) : 0,
+			s.latency_max_us, s.handling_max_us);
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_event_bus(const struct shell *shell, size_t argc, char **argv)
+{
+	struct event_bus_stats s;
+
+	shell_print(shell, "%-12s %8s %8s %10s %10s %10s", "event", "count",
+		    "dropped", "avg us", "max us", "handle us");
+
+	for (size_t i = 0; i < EVENT_BUS_TYPE_COUNT; i++) {
+		event_bus_stats_get(i, &s);
+
+		shell_print(shell, "%-12s %8u %8u %10u %10u %10u", s.name,
+			    s.count, s.dropped,
+			    s.count ? (u32_t)(s.latency_sum_us / s.count) : 0,
+			    s.latency_max_us, s.handling_max_us);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(event_bus, NULL, "Event dispatch statistics",
+		   cmd_event_bus);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef EVENT_BUS_H__
+#define EVENT_BUS_H__
+
+#include <zephyr.h>
+#include <drivers/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum event_bus_type {
+	/** Acceleration above the configured threshold. */
+	EVENT_BUS_MOTION,
+	/** Fix accepted by the fix selection during a search. */
+	EVENT_BUS_GPS_FIX,
+	/** Configuration received from the cloud has been applied. */
+	EVENT_BUS_CFG_UPDATED,
+
+	EVENT_BUS_TYPE_COUNT
+};
+
+struct event_bus_evt {
+	enum event_bus_type type;
+	/** Cycle counter at publish, set by event_bus_publish(). */
+	u32_t cycles;
+	union {
+		struct {
+			double acc[3];
+			s64_t ts;
+		} motion;
+		struct gps_pvt gps_fix;
+		struct {
+			u32_t version;
+		} cfg;
+	};
+};
+
+typedef void (*event_bus_handler_t)(const struct event_bus_evt *evt);
+
+struct event_bus_subscriber {
+	enum event_bus_type type;
+	event_bus_handler_t handler;
+};
+
+/**
+ * @brief Subscribes a handler to an event type at build time. Handlers
+ *	  run on the dispatch thread, in link order.
+ */
+#define EVENT_BUS_SUBSCRIBE(_name, _type, _handler)			\
+	const Z_STRUCT_SECTION_ITERABLE(event_bus_subscriber, _name) = {	\
+		.type = _type,						\
+		.handler = _handler,					\
+	}
+
+/** Dispatch statistics of an event type. */
+struct event_bus_stats {
+	const char *name;
+	u32_t count;
+	u32_t dropped;
+	/** Time from publish until the first handler runs. */
+	u32_t latency_max_us;
+	u64_t latency_sum_us;
+	/** Time spent in all handlers of an event. */
+	u32_t handling_max_us;
+};
+
+/**
+ * @brief Copies an event into the queue of the dispatch thread. Can be
+ *	  called from any context, including ISRs.
+ *
+ * @return 0 on success, -ENOMEM if the queue is full.
+ */
+int event_bus_publish(struct event_bus_evt *evt);
+
+void event_bus_stats_get(enum event_bus_type type,
+			 struct event_bus_stats *stats);
+
+/**
+ * @brief Logs the dispatch statistics of each event type.
+ */
+void event_bus_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* EVENT_BUS_H__ */
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <math.h>
+#include <string.h>
+
+#include "fix_selection.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(fix_selection, CONFIG_FIX_SELECTION_LOG_LEVEL);
+
+#define EARTH_RADIUS_METERS	6371000.0f
+#define DEG_TO_RAD		(3.14159265f / 180.0f)
+
+struct fix_candidate {
+	struct gps_pvt pvt;
+	s64_t ts;
+	float score;
+	bool valid;
+};
+
+/* The part of a fix that new fixes are compared to. */
+struct fix_position {
+	double latitude;
+	double longitude;
+	float accuracy;
+	s64_t ts;
+	bool valid;
+};
+
+static struct fix_candidate best;
+static struct fix_position last;
+static struct fix_position reference;
+/* Incremented when last or reference is changed by another thread. */
+static u32_t generation;
+
+static struct k_spinlock lock;
+
+static void position_set(struct fix_position *pos, const struct gps_pvt *pvt,
+			 s64_t ts)
+{
+	pos->latitude = pvt->latitude;
+	pos->longitude = pvt->longitude;
+	pos->accuracy = pvt->accuracy;
+	pos->ts = ts;
+	pos->valid = true;
+}
+
+/* Equirectangular approximation, accurate enough for the distances
+ * between consecutive fixes.
+ */
+static float distance_get(const struct fix_position *a,
+			  const struct gps_pvt *b)
+{
+	float lat = (float)(a->latitude + b->latitude) / 2.0f * DEG_TO_RAD;
+	float dx = (float)(b->longitude - a->longitude) * DEG_TO_RAD *
+		   cosf(lat);
+	float dy = (float)(b->latitude - a->latitude) * DEG_TO_RAD;
+
+	return sqrtf(dx * dx + dy * dy) * EARTH_RADIUS_METERS;
+}
+
+static int satellites_in_fix(const struct gps_pvt *pvt)
+{
+	int count = 0;
+
+	for (size_t i = 0; i < GPS_PVT_MAX_SV_COUNT; i++) {
+		if (pvt->sv[i].sv != 0 && pvt->sv[i].in_fix) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* Checks the jump from the fix selected in the previous search window.
+ * Only the part of the jump not covered by the accuracy of the two fixes
+ * counts towards the implied speed.
+ */
+static bool is_plausible(const struct fix_position *reference,
+			 const struct gps_pvt *pvt, s64_t ts, float *distance)
+{
+	float dt, margin;
+
+	if (!reference->valid) {
+		return true;
+	}
+
+	*distance = distance_get(reference, pvt);
+	margin = reference->accuracy + pvt->accuracy;
+	dt = (ts - reference->ts) / 1000.0f;
+
+	if (*distance <= margin) {
+		return true;
+	}
+
+	return dt > 0.0f &&
+	       (*distance - margin) / dt <= CONFIG_FIX_SELECTION_MAX_SPEED;
+}
+
+/* Lower is better. The score is the reported accuracy weighted by the
+ * number of satellites used in the fix, and by how well the reported
+ * speed matches the movement since the previous candidate.
+ */
+static float score_get(const struct fix_position *last,
+		       const struct gps_pvt *pvt, s64_t ts)
+{
+	int satellites = satellites_in_fix(pvt);
+	float score = pvt->accuracy;
+
+	/* Some GPS devices do not report satellite usage. */
+	if (satellites > 0) {
+		score *= (float)CONFIG_FIX_SELECTION_SATELLITE_REF / satellites;
+	}
+
+	if (last->valid && ts > last->ts) {
+		float dt = (ts - last->ts) / 1000.0f;
+		float implied = distance_get(last, pvt) / dt;
+		float deviation = fabsf(implied - pvt->speed);
+
+		if (deviation > CONFIG_FIX_SELECTION_SPEED_TOLERANCE) {
+			score *= 1.0f + deviation /
+				 CONFIG_FIX_SELECTION_SPEED_TOLERANCE;
+		}
+	}
+
+	return score;
+}
+
+void fix_selection_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	best.valid = false;
+	last.valid = false;
+	generation++;
+
+	k_spin_unlock(&lock, key);
+}
+
+/* The score is computed outside the lock from copies of the positions it
+ * depends on, and computed again if another thread changed them meanwhile.
+ */
+int fix_selection_add(const struct gps_pvt *pvt)
+{
+	s64_t ts = k_uptime_get();
+	struct fix_position prev_last;
+	struct fix_position prev_reference;
+	k_spinlock_key_t key;
+	u32_t prev_generation;
+	float distance = 0.0f;
+	float score = 0.0f;
+	int err;
+
+	key = k_spin_lock(&lock);
+
+	do {
+		prev_last = last;
+		prev_reference = reference;
+		prev_generation = generation;
+		k_spin_unlock(&lock, key);
+
+		err = 0;
+		if (!is_plausible(&prev_reference, pvt, ts, &distance)) {
+			err = -EINVAL;
+		} else {
+			score = score_get(&prev_last, pvt, ts);
+		}
+
+		key = k_spin_lock(&lock);
+	} while (generation != prev_generation);
+
+	if (err) {
+		goto exit;
+	}
+
+	position_set(&last, pvt, ts);
+
+	if (best.valid && score >= best.score) {
+		err = -EALREADY;
+		goto exit;
+	}
+
+	best.pvt = *pvt;
+	best.ts = ts;
+	best.score = score;
+	best.valid = true;
+
+exit:
+	k_spin_unlock(&lock, key);
+
+	if (err == -EINVAL) {
+		LOG_WRN("Rejecting fix %d m from the previously selected fix",
+			(int)distance);
+	} else if (!err) {
+		LOG_DBG("New best candidate, accuracy %d m, score %d",
+			(int)pvt->accuracy, (int)score);
+	}
+
+	return err;
+}
+
+int fix_selection_get(struct gps_pvt *pvt)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int err = -ENODATA;
+
+	if (best.valid) {
+		*pvt = best.pvt;
+		position_set(&reference, &best.pvt, best.ts);
+		best.valid = false;
+		last.valid = false;
+		generation++;
+		err = 0;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return err;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Selection of the best position fix within a GPS search.
+ */
+
+#ifndef FIX_SELECTION_H__
+#define FIX_SELECTION_H__
+
+#include <zephyr.h>
+#include <drivers/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Discards the candidates of the current search window. */
+void fix_selection_reset(void);
+
+/**
+ * @brief Adds a fix to the current search window.
+ *
+ * @param pvt Position fix from the GPS device.
+ *
+ * @return 0 if the fix is kept as the best candidate so far, -EALREADY if
+ *         a better candidate exists and -EINVAL if the fix is rejected as
+ *         an outlier.
+ */
+int fix_selection_add(const struct gps_pvt *pvt);
+
+/**
+ * @brief Takes the best candidate of the search window and closes it.
+ *
+ * The returned fix is used as reference for the plausibility check of the
+ * next search window.
+ *
+ * @param pvt Pointer to where the selected fix is copied.
+ *
+ * @return 0 on success, -ENODATA if the window holds no candidate.
+ */
+int fix_selection_get(struct gps_pvt *pvt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIX_SELECTION_H__ */
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <math.h>
+#include <string.h>
+
+#include "geofence.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(geofence, CONFIG_GEOFENCE_LOG_LEVEL);
+
+/* Meters per degree of latitude. */
+#define METERS_PER_DEGREE	111195
+#define MICRODEGREES		1000000
+#define DEG_TO_RAD		(3.14159265 / 180.0)
+/* Fraction bits of the fixed-point longitude scale factor. */
+#define LNG_SCALE_SHIFT		16
+
+enum fence_state {
+	FENCE_STATE_UNKNOWN,
+	FENCE_STATE_OUTSIDE,
+	FENCE_STATE_INSIDE,
+};
+
+struct fence_entry {
+	struct geofence fence;
+	enum fence_state state;
+
+	/* Precomputed when the fence is set. */
+	struct geofence_point min;
+	struct geofence_point max;
+	s64_t radius_sq;
+	s32_t lng_scale;
+};
+
+static struct fence_entry fences[CONFIG_GEOFENCE_MAX_FENCES];
+static size_t fence_cnt;
+static bool is_home;
+
+static geofence_event_handler_t event_handler;
+static struct k_spinlock lock;
+
+static s32_t to_microdegrees(double degrees)
+{
+	return (s32_t)(degrees * MICRODEGREES);
+}
+
+/* Longitude degrees shrink with the cosine of the latitude. The scale
+ * factor maps longitude differences to latitude-equivalent micro degrees
+ * so that distances can be compared in integer arithmetic.
+ */
+static s32_t lng_scale_get(s32_t lat)
+{
+	return (s32_t)(cos((double)lat / MICRODEGREES * DEG_TO_RAD) *
+		       (1 << LNG_SCALE_SHIFT));
+}
+
+static int precompute(struct fence_entry *entry)
+{
+	struct geofence *fence = &entry->fence;
+
+	if (fence->type == GEOFENCE_CIRCLE) {
+		s32_t dlat = (s64_t)fence->radius * MICRODEGREES /
+			     METERS_PER_DEGREE;
+		s32_t dlng;
+
+		if (fence->radius == 0 || fence->radius > GEOFENCE_RADIUS_MAX) {
+			return -EINVAL;
+		}
+
+		entry->lng_scale = lng_scale_get(fence->center.lat);
+		if (entry->lng_scale <= 0) {
+			return -EINVAL;
+		}
+
+		dlng = ((s64_t)dlat << LNG_SCALE_SHIFT) / entry->lng_scale;
+
+		entry->min.lat = fence->center.lat - dlat;
+		entry->max.lat = fence->center.lat + dlat;
+		entry->min.lng = fence->center.lng - dlng;
+		entry->max.lng = fence->center.lng + dlng;
+		entry->radius_sq = (s64_t)dlat * dlat;
+
+		return 0;
+	}
+
+	if (fence->vertex_cnt < 3 ||
+	    fence->vertex_cnt > CONFIG_GEOFENCE_MAX_VERTICES) {
+		return -EINVAL;
+	}
+
+	entry->min = fence->vertices[0];
+	entry->max = fence->vertices[0];
+
+	for (size_t i = 1; i < fence->vertex_cnt; i++) {
+		entry->min.lat = MIN(entry->min.lat, fence->vertices[i].lat);
+		entry->min.lng = MIN(entry->min.lng, fence->vertices[i].lng);
+		entry->max.lat = MAX(entry->max.lat, fence->vertices[i].lat);
+		entry->max.lng = MAX(entry->max.lng, fence->vertices[i].lng);
+	}
+
+	return 0;
+}
+
+static bool in_circle(const struct fence_entry *entry,
+		      const struct geofence_point *p)
+{
+	s64_t dlat = p->lat - entry->fence.center.lat;
+	s64_t dlng = ((s64_t)(p->lng - entry->fence.center.lng) *
+		      entry->lng_scale) >> LNG_SCALE_SHIFT;
+
+	return dlat * dlat + dlng * dlng <= entry->radius_sq;
+}
+
+/* Crossing number test. The intersection of each edge with the
+ * horizontal ray through the point is compared by cross-multiplication,
+ * so no division is needed.
+ */
+static bool in_polygon(const struct fence_entry *entry,
+		       const struct geofence_point *p)
+{
+	const struct geofence_point *v = entry->fence.vertices;
+	size_t n = entry->fence.vertex_cnt;
+	bool inside = false;
+
+	for (size_t i = 0, j = n - 1; i < n; j = i++) {
+		if ((v[i].lat > p->lat) == (v[j].lat > p->lat)) {
+			continue;
+		}
+
+		s64_t lhs = (s64_t)(p->lng - v[i].lng) * (v[j].lat - v[i].lat);
+		s64_t rhs = (s64_t)(v[j].lng - v[i].lng) * (p->lat - v[i].lat);
+
+		if ((v[j].lat > v[i].lat) ? (lhs < rhs) : (lhs > rhs)) {
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+static bool is_inside(const struct fence_entry *entry,
+		      const struct geofence_point *p)
+{
+	if (p->lat < entry->min.lat || p->lat > entry->max.lat ||
+	    p->lng < entry->min.lng || p->lng > entry->max.lng) {
+		return false;
+	}
+
+	if (entry->fence.type == GEOFENCE_CIRCLE) {
+		return in_circle(entry, p);
+	}
+
+	return in_polygon(entry, p);
+}
+
+void geofence_init(geofence_event_handler_t handler)
+{
+	event_handler = handler;
+}
+
+static bool fence_equal(const struct geofence *a, const struct geofence *b)
+{
+	if (a->id != b->id || a->type != b->type || a->home != b->home) {
+		return false;
+	}
+
+	if (a->type == GEOFENCE_CIRCLE) {
+		return a->radius == b->radius &&
+		       a->center.lat == b->center.lat &&
+		       a->center.lng == b->center.lng;
+	}
+
+	return a->vertex_cnt == b->vertex_cnt &&
+	       memcmp(a->vertices, b->vertices,
+		      a->vertex_cnt * sizeof(a->vertices[0])) == 0;
+}
+
+/* Returns the state of an unchanged fence of the current set. */
+static enum fence_state state_find(const struct geofence *fence)
+{
+	for (size_t i = 0; i < fence_cnt; i++) {
+		if (fence_equal(&fences[i].fence, fence)) {
+			return fences[i].state;
+		}
+	}
+
+	return FENCE_STATE_UNKNOWN;
+}
+
+int geofence_set(const struct geofence *new_fences, size_t count)
+{
+	static struct fence_entry entries[CONFIG_GEOFENCE_MAX_FENCES];
+	k_spinlock_key_t key;
+	int err;
+
+	if (count > ARRAY_SIZE(entries)) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		entries[i].fence = new_fences[i];
+
+		err = precompute(&entries[i]);
+		if (err) {
+			LOG_ERR("Invalid fence, id: %d", new_fences[i].id);
+			return err;
+		}
+	}
+
+	key = k_spin_lock(&lock);
+
+	is_home = false;
+	for (size_t i = 0; i < count; i++) {
+		entries[i].state = state_find(&entries[i].fence);
+		if (entries[i].state == FENCE_STATE_INSIDE &&
+		    entries[i].fence.home) {
+			is_home = true;
+		}
+	}
+
+	memcpy(fences, entries, count * sizeof(entries[0]));
+	fence_cnt = count;
+	k_spin_unlock(&lock, key);
+
+	LOG_INF("%d fence(s) set", count);
+
+	return 0;
+}
+
+void geofence_evaluate(double latitude, double longitude)
+{
+	struct geofence_event events[CONFIG_GEOFENCE_MAX_FENCES];
+	struct geofence_point p = {
+		.lat = to_microdegrees(latitude),
+		.lng = to_microdegrees(longitude)
+	};
+	size_t event_cnt = 0;
+	bool home = false;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < fence_cnt; i++) {
+		struct fence_entry *entry = &fences[i];
+		enum fence_state state = is_inside(entry, &p) ?
+					 FENCE_STATE_INSIDE :
+					 FENCE_STATE_OUTSIDE;
+
+		if (state == FENCE_STATE_INSIDE && entry->fence.home) {
+			home = true;
+		}
+
+		/* Only report the initial state if inside the fence. */
+		if (state == entry->state ||
+		    (entry->state == FENCE_STATE_UNKNOWN &&
+		     state == FENCE_STATE_OUTSIDE)) {
+			entry->state = state;
+			continue;
+		}
+
+		entry->state = state;
+		events[event_cnt++] = (struct geofence_event) {
+			.id = entry->fence.id,
+			.inside = state == FENCE_STATE_INSIDE,
+			.home = entry->fence.home,
+			.latitude = latitude,
+			.longitude = longitude,
+			.timestamp = k_uptime_get()
+		};
+	}
+
+	is_home = home;
+
+	k_spin_unlock(&lock, key);
+
+	for (size_t i = 0; i < event_cnt; i++) {
+		LOG_INF("Fence %d %s", events[i].id,
+			events[i].inside ? "entered" : "exited");
+
+		if (event_handler) {
+			event_handler(&events[i]);
+		}
+	}
+}
+
+bool geofence_is_home(void)
+{
+	return is_home;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Geofence evaluation of position fixes.
+ */
+
+#ifndef GEOFENCE_H__
+#define GEOFENCE_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Position in micro degrees. */
+struct geofence_point {
+	s32_t lat;
+	s32_t lng;
+};
+
+/** @brief Largest circle radius in meters, half the Earth circumference. */
+#define GEOFENCE_RADIUS_MAX 20000000
+
+enum geofence_type {
+	GEOFENCE_CIRCLE,
+	GEOFENCE_POLYGON,
+};
+
+/** @brief Fence as delivered through the device configuration. */
+struct geofence {
+	u8_t id;
+	enum geofence_type type;
+	bool home;
+
+	/* Circle */
+	struct geofence_point center;
+	u32_t radius;
+
+	/* Polygon */
+	struct geofence_point vertices[CONFIG_GEOFENCE_MAX_VERTICES];
+	u8_t vertex_cnt;
+};
+
+/** @brief Fence enter or exit event. */
+struct geofence_event {
+	u8_t id;
+	bool inside;
+	bool home;
+	double latitude;
+	double longitude;
+	s64_t timestamp;
+};
+
+typedef void (*geofence_event_handler_t)(const struct geofence_event *evt);
+
+/**
+ * @brief Initializes the geofence module.
+ *
+ * @param handler Handler called on fence enter and exit, from the context
+ *                of geofence_evaluate().
+ */
+void geofence_init(geofence_event_handler_t handler);
+
+/**
+ * @brief Replaces the set of fences.
+ *
+ * Fences with the same id and geometry as in the current set keep their
+ * inside/outside state. The state of new and changed fences is unknown,
+ * so that the next fix reports them if the device is inside.
+ *
+ * @param fences Array of fences.
+ * @param count Number of fences.
+ *
+ * @return 0 on success, -EINVAL if a fence is invalid or too many fences
+ *         are given.
+ */
+int geofence_set(const struct geofence *fences, size_t count);
+
+/**
+ * @brief Evaluates a position fix against all fences.
+ *
+ * @param latitude Latitude in degrees.
+ * @param longitude Longitude in degrees.
+ */
+void geofence_evaluate(double latitude, double longitude);
+
+/** @brief Returns true if the last fix was inside a home fence. */
+bool geofence_is_home(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEOFENCE_H__ */
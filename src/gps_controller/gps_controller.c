@@ -5,18 +5,37 @@
  */
 
 #include <zephyr.h>
+#include <string.h>
 #include <misc/util.h>
 #include <drivers/gps.h>
 #include <lte_lc.h>
 
 #include "ui.h"
 #include "gps_controller.h"
-
+#include <metrics.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(gps_control, CONFIG_GPS_CONTROL_LOG_LEVEL);
 
 #if !defined(CONFIG_GPS_SIM)
+/* Time after a fix for which the ephemerides held by the modem are valid,
+ * giving a hot start.
+ */
+#define GPS_HOT_START_MAX_AGE_MS	K_HOURS(4)
+/* Time after a fix for which the almanac and coarse time are still good
+ * enough for a warm start.
+ */
+#define GPS_WARM_START_MAX_AGE_MS	K_HOURS(7 * 24)
+
+static const char * const start_type_str[] = {
+	[GPS_START_HOT] = "hot",
+	[GPS_START_WARM] = "warm",
+	[GPS_START_COLD] = "cold",
+};
+
 /* Structure to hold GPS work information */
 static struct {
 	enum {
@@ -24,12 +43,87 @@ static struct {
 		GPS_WORK_STOP
 	} type;
 	struct k_delayed_work work;
+	struct k_delayed_work timeout_work;
+	struct k_delayed_work resume_work;
 	struct device *dev;
 } gps_work;
 
+/* GNSS session state. Searching is left either by a fix that meets the
+ * accuracy target, by the try time running out or by the application
+ * stopping the search. Too many failed sessions in a row suspend the
+ * GPS for CONFIG_GPS_CONTROL_SUSPEND_TIME seconds.
+ */
+enum gps_state {
+	GPS_STATE_IDLE,
+	GPS_STATE_SEARCHING,
+	GPS_STATE_FIX,
+	GPS_STATE_SUSPENDED,
+};
+
+static struct {
+	enum gps_start_type start_type;
+	s64_t start_ts;
+	s64_t last_fix_ts;
+	u32_t fix_count;
+	u32_t failed_attempts;
+} session;
+
+/* Updated from the GPS trigger handler and the system workqueue, and read
+ * from other threads.
+ */
+static struct gps_control_stats stats;
+static struct k_spinlock stats_lock;
+
+static atomic_t gps_state;
 static atomic_t gps_is_active;
 static atomic_t gps_is_enabled;
 
+static enum gps_start_type start_type_get(void)
+{
+	s64_t age;
+
+	if (session.last_fix_ts == 0) {
+		return GPS_START_COLD;
+	}
+
+	age = k_uptime_get() - session.last_fix_ts;
+
+	if (age < GPS_HOT_START_MAX_AGE_MS) {
+		return GPS_START_HOT;
+	} else if (age < GPS_WARM_START_MAX_AGE_MS) {
+		return GPS_START_WARM;
+	}
+
+	return GPS_START_COLD;
+}
+
+static void ttff_update(u32_t ttff)
+{
+	struct gps_control_ttff *entry = &stats.ttff[session.start_type];
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	u32_t count, avg;
+
+	if (entry->count == 0 || ttff < entry->min_ms) {
+		entry->min_ms = ttff;
+	}
+
+	if (ttff > entry->max_ms) {
+		entry->max_ms = ttff;
+	}
+
+	entry->sum_ms += ttff;
+	entry->count++;
+	count = entry->count;
+	avg = (u32_t)(entry->sum_ms / count);
+
+	k_spin_unlock(&stats_lock, key);
+
+	metrics_histogram_add(METRICS_TTFF, ttff / MSEC_PER_SEC);
+
+	LOG_INF("TTFF %d ms, %s start, average %d ms over %d fixes",
+		ttff, start_type_str[session.start_type], avg, count);
+}
+
 static int start(void)
 {
 	int err;
@@ -54,7 +148,16 @@ static int start(void)
 
 	atomic_set(&gps_is_active, 1);
 
-	LOG_INF("GPS started successfully.Searching for satellites");
+	session.start_type = start_type_get();
+	session.start_ts = k_uptime_get();
+	session.fix_count = 0;
+	atomic_set(&gps_state, GPS_STATE_SEARCHING);
+
+	k_delayed_work_submit(&gps_work.timeout_work,
+			      K_SECONDS(CONFIG_GPS_CONTROL_FIX_TRY_TIME));
+
+	LOG_INF("GPS started successfully, %s start. Searching for satellites",
+		start_type_str[session.start_type]);
 	LOG_INF("to get position fix. This may take several minutes.");
 
 	return 0;
@@ -62,8 +165,11 @@ static int start(void)
 
 static int stop(void)
 {
+	k_spinlock_key_t key;
 	int err;
 
+	k_delayed_work_cancel(&gps_work.timeout_work);
+
 	if (IS_ENABLED(CONFIG_GPS_CONTROL_PSM_DISABLE_ON_STOP)) {
 		LOG_INF("Disabling PSM");
 
@@ -78,6 +184,41 @@ static int stop(void)
 		return err;
 	}
 
+	if (atomic_get(&gps_is_active)) {
+		s64_t on_time = k_uptime_get() - session.start_ts;
+
+		key = k_spin_lock(&stats_lock);
+
+		stats.on_time_ms += on_time;
+		k_spin_unlock(&stats_lock, key);
+	}
+
+	if (!atomic_cas(&gps_state, GPS_STATE_SEARCHING, GPS_STATE_IDLE)) {
+		atomic_cas(&gps_state, GPS_STATE_FIX, GPS_STATE_IDLE);
+		return 0;
+	}
+
+	session.failed_attempts++;
+	key = k_spin_lock(&stats_lock);
+	stats.failed_attempts++;
+	k_spin_unlock(&stats_lock, key);
+
+	LOG_INF("No fix within the search, %d failed attempt(s) in a row",
+		session.failed_attempts);
+
+	if (session.failed_attempts >=
+	    CONFIG_GPS_CONTROL_MAX_FAILED_FIX_ATTEMPTS) {
+		LOG_WRN("Suspending GPS for %d seconds",
+			CONFIG_GPS_CONTROL_SUSPEND_TIME);
+
+		atomic_set(&gps_state, GPS_STATE_SUSPENDED);
+		key = k_spin_lock(&stats_lock);
+		stats.suspensions++;
+		k_spin_unlock(&stats_lock, key);
+		k_delayed_work_submit(&gps_work.resume_work,
+				      K_SECONDS(CONFIG_GPS_CONTROL_SUSPEND_TIME));
+	}
+
 	return 0;
 }
 
@@ -109,7 +250,8 @@ static void gps_work_handler(struct k_work *work)
 
 		atomic_set(&gps_is_active, 0);
 
-		if (atomic_get(&gps_is_enabled) == 0) {
+		if (atomic_get(&gps_is_enabled) == 0 ||
+		    atomic_get(&gps_state) == GPS_STATE_SUSPENDED) {
 			return;
 		}
 
@@ -123,6 +265,23 @@ static void gps_work_handler(struct k_work *work)
 			K_SECONDS(CONFIG_GPS_CONTROL_FIX_CHECK_INTERVAL));
 	}
 }
+
+static void gps_timeout_work_handler(struct k_work *work)
+{
+	LOG_INF("GPS try time of %d seconds has passed",
+		CONFIG_GPS_CONTROL_FIX_TRY_TIME);
+
+	gps_control_stop(K_NO_WAIT);
+}
+
+static void gps_resume_work_handler(struct k_work *work)
+{
+	session.failed_attempts = 0;
+
+	if (atomic_cas(&gps_state, GPS_STATE_SUSPENDED, GPS_STATE_IDLE)) {
+		LOG_INF("GPS resumed after suspension");
+	}
+}
 #endif /* !defined(GPS_SIM) */
 
 bool gps_control_is_active(void)
@@ -143,10 +302,24 @@ bool gps_control_is_enabled(void)
 #endif
 }
 
+bool gps_control_is_suspended(void)
+{
+#if !defined(CONFIG_GPS_SIM)
+	return atomic_get(&gps_state) == GPS_STATE_SUSPENDED;
+#else
+	return false;
+#endif
+}
+
 void gps_control_enable(void)
 {
 #if !defined(CONFIG_GPS_SIM)
 	atomic_set(&gps_is_enabled, 1);
+
+	/* User input lifts a suspension caused by failed fix attempts. */
+	k_delayed_work_cancel(&gps_work.resume_work);
+	gps_resume_work_handler(NULL);
+
 	gps_control_start(K_SECONDS(1));
 #endif
 }
@@ -169,19 +342,71 @@ void gps_control_stop(u32_t delay_ms)
 #endif
 }
 
-void gps_control_start(u32_t delay_ms)
+int gps_control_start(u32_t delay_ms)
 {
 #if !defined(CONFIG_GPS_SIM)
+	if (gps_control_is_suspended()) {
+		LOG_INF("GPS is suspended, not starting");
+		return -EBUSY;
+	}
+
 	k_delayed_work_cancel(&gps_work.work);
 	gps_work.type = GPS_WORK_START;
 	k_delayed_work_submit(&gps_work.work, delay_ms);
 #endif
+	return 0;
+}
+
+int gps_control_on_trigger(const struct gps_pvt *pvt)
+{
+#if !defined(CONFIG_GPS_SIM)
+	k_spinlock_key_t key;
+
+	if (atomic_get(&gps_state) != GPS_STATE_SEARCHING) {
+		return -EALREADY;
+	}
+
+	if (session.fix_count++ == 0) {
+		ttff_update(k_uptime_get() - session.start_ts);
+	}
+
+	session.last_fix_ts = k_uptime_get();
+
+	if (pvt->accuracy > CONFIG_GPS_CONTROL_ACCURACY_TARGET &&
+	    session.fix_count < CONFIG_GPS_CONTROL_FIX_COUNT) {
+		LOG_DBG("Fix accuracy %d m above target, keep searching",
+			(int)pvt->accuracy);
+		return -EAGAIN;
+	}
+
+	if (!atomic_cas(&gps_state, GPS_STATE_SEARCHING, GPS_STATE_FIX)) {
+		return -EALREADY;
+	}
+
+	session.failed_attempts = 0;
+	key = k_spin_lock(&stats_lock);
+	stats.fixes++;
+	k_spin_unlock(&stats_lock, key);
+
+	LOG_INF("Fix accepted after %d fix(es), accuracy %d m",
+		session.fix_count, (int)pvt->accuracy);
+
+	gps_control_stop(K_NO_WAIT);
+#else
+	ARG_UNUSED(pvt);
+#endif
+	return 0;
 }
 
-void gps_control_on_trigger(void)
+void gps_control_stats_get(struct gps_control_stats *out)
 {
 #if !defined(CONFIG_GPS_SIM)
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
 
+	*out = stats;
+	k_spin_unlock(&stats_lock, key);
+#else
+	memset(out, 0, sizeof(*out));
 #endif
 }
 
@@ -217,6 +442,8 @@ int gps_control_init(gps_trigger_handler_t handler)
 
 #if !defined(CONFIG_GPS_SIM)
 	k_delayed_work_init(&gps_work.work, gps_work_handler);
+	k_delayed_work_init(&gps_work.timeout_work, gps_timeout_work_handler);
+	k_delayed_work_init(&gps_work.resume_work, gps_resume_work_handler);
 
 	gps_work.dev = gps_dev;
 #endif
@@ -224,3 +451,36 @@ int gps_control_init(gps_trigger_handler_t handler)
 
 	return 0;
 }
+
+#if defined(CONFIG_SHELL) && !defined(CONFIG_GPS_SIM)
+static int cmd_gps_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct gps_control_stats summary;
+
+	gps_control_stats_get(&summary);
+
+	shell_print(shell, "%-6s %8s %10s %10s %10s", "start", "count",
+		    "min ms", "avg ms", "max ms");
+
+	for (size_t i = 0; i < GPS_START_TYPE_COUNT; i++) {
+		const struct gps_control_ttff *ttff = &summary.ttff[i];
+
+		shell_print(shell, "%-6s %8u %10u %10u %10u", start_type_str[i],
+			    ttff->count, ttff->min_ms,
+			    ttff->count ?
+			    (u32_t)(ttff->sum_ms / ttff->count) : 0,
+			    ttff->max_ms);
+	}
+
+	shell_print(shell, "fixes %u, failed attempts %u, suspensions %u",
+		    summary.fixes, summary.failed_attempts,
+		    summary.suspensions);
+	shell_print(shell, "on time %u s",
+		    (u32_t)(summary.on_time_ms / MSEC_PER_SEC));
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(gps_stats, NULL, "Print the GNSS session statistics",
+		   cmd_gps_stats);
+#endif /* CONFIG_SHELL && !CONFIG_GPS_SIM */
@@ -13,23 +13,72 @@
 #define GPS_CONTROLLER_H__
 
 #include <zephyr.h>
+#include <drivers/gps.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** @brief GNSS start types, given by the age of the last fix. */
+enum gps_start_type {
+	GPS_START_HOT,
+	GPS_START_WARM,
+	GPS_START_COLD,
+	GPS_START_TYPE_COUNT
+};
+
+/** @brief Time to first fix statistics for one start type. */
+struct gps_control_ttff {
+	u32_t count;
+	u32_t min_ms;
+	u32_t max_ms;
+	u64_t sum_ms;
+};
+
+/** @brief GNSS session statistics. */
+struct gps_control_stats {
+	struct gps_control_ttff ttff[GPS_START_TYPE_COUNT];
+	u32_t fixes;
+	u32_t failed_attempts;
+	u32_t suspensions;
+	u64_t on_time_ms;
+};
+
 int gps_control_init(gps_trigger_handler_t handler);
 
-void gps_control_on_trigger(void);
+/**
+ * @brief Feeds a position fix into the GNSS session.
+ *
+ * @param pvt Position fix from the GPS device.
+ *
+ * @return 0 if the fix ends the session and the GPS is being stopped,
+ *         -EAGAIN if the fix is below the accuracy target and the search
+ *         continues, -EALREADY if no session is ongoing.
+ */
+int gps_control_on_trigger(const struct gps_pvt *pvt);
 
 void gps_control_stop(u32_t delay_ms);
 
-void gps_control_start(u32_t delay_ms);
+/**
+ * @brief Starts a GNSS session after the given delay.
+ *
+ * @return 0 on success, -EBUSY if the GPS is suspended after too many
+ *         failed fix attempts.
+ */
+int gps_control_start(u32_t delay_ms);
 
 bool gps_control_is_active(void);
 
 bool gps_control_is_enabled(void);
 
+bool gps_control_is_suspended(void);
+
+/**
+ * @brief Copies the GNSS session statistics since boot. They are also
+ *	  printed by the gps_stats shell command.
+ */
+void gps_control_stats_get(struct gps_control_stats *out);
+
 void gps_control_enable(void);
 
 void gps_control_disable(void);
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <string.h>
+#include <time.h>
+#include <drivers/gps.h>
+
+#include "gps_replay.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(gps_replay, CONFIG_GPS_REPLAY_LOG_LEVEL);
+
+/* Time since the last fix within which a search is a hot start. */
+#define HOT_START_MAX_AGE	K_SECONDS(4 * 60 * 60)
+
+struct replay_data {
+	struct device *dev;
+	gps_trigger_handler_t handler;
+	struct gps_trigger trigger;
+	struct k_delayed_work tick_work;
+	struct gps_pvt pvt;
+	s64_t fix_allowed_ts;
+	s64_t last_fix_ts;
+	bool running;
+	struct k_spinlock lock;
+};
+
+static struct replay_data replay_data;
+
+/* The trace is replayed in a loop from boot, so a search sees the part
+ * of the trace matching the current uptime.
+ */
+static const struct gps_replay_record *record_get(s64_t now)
+{
+	u32_t period = gps_replay_trace[gps_replay_trace_len - 1].ts +
+		       CONFIG_GPS_REPLAY_INTERVAL;
+	u32_t pos = now % period;
+	size_t lo = 0;
+	size_t hi = gps_replay_trace_len;
+
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+
+		if (gps_replay_trace[mid].ts <= pos) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (gps_replay_trace[lo].ts > pos ||
+	    pos - gps_replay_trace[lo].ts > CONFIG_GPS_REPLAY_MAX_GAP) {
+		return NULL;
+	}
+
+	return &gps_replay_trace[lo];
+}
+
+static void pvt_fill(struct gps_pvt *pvt, const struct gps_replay_record *rec,
+		     s64_t now)
+{
+	s64_t utc_ms = gps_replay_trace_epoch + now;
+	time_t utc = utc_ms / 1000;
+	struct tm tm;
+
+	gmtime_r(&utc, &tm);
+
+	memset(pvt, 0, sizeof(*pvt));
+
+	pvt->latitude = rec->latitude;
+	pvt->longitude = rec->longitude;
+	pvt->altitude = rec->altitude;
+	pvt->accuracy = rec->accuracy;
+	pvt->speed = rec->speed;
+
+	pvt->datetime.year = tm.tm_year + 1900;
+	pvt->datetime.month = tm.tm_mon + 1;
+	pvt->datetime.day = tm.tm_mday;
+	pvt->datetime.hour = tm.tm_hour;
+	pvt->datetime.minute = tm.tm_min;
+	pvt->datetime.seconds = tm.tm_sec;
+	pvt->datetime.ms = utc_ms % 1000;
+
+	for (size_t i = 0; i < MIN(rec->satellites, GPS_PVT_MAX_SV_COUNT);
+	     i++) {
+		pvt->sv[i].sv = i + 1;
+		pvt->sv[i].in_fix = 1;
+	}
+}
+
+static void tick_work_fn(struct k_work *work)
+{
+	struct replay_data *data = &replay_data;
+	const struct gps_replay_record *rec;
+	s64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+
+	if (!data->running) {
+		return;
+	}
+
+	k_delayed_work_submit(&data->tick_work, CONFIG_GPS_REPLAY_INTERVAL);
+
+	rec = record_get(now);
+	if (now < data->fix_allowed_ts || rec == NULL) {
+		return;
+	}
+
+	key = k_spin_lock(&data->lock);
+	pvt_fill(&data->pvt, rec, now);
+	k_spin_unlock(&data->lock, key);
+
+	data->last_fix_ts = now;
+
+	if (data->handler) {
+		data->handler(data->dev, &data->trigger);
+	}
+}
+
+static int replay_start(struct device *dev)
+{
+	struct replay_data *data = dev->driver_data;
+	s64_t now = k_uptime_get();
+	bool hot = data->last_fix_ts >= 0 &&
+		   now - data->last_fix_ts < HOT_START_MAX_AGE;
+
+	if (data->running) {
+		return 0;
+	}
+
+	data->fix_allowed_ts = now + (hot ? CONFIG_GPS_REPLAY_TTFF_HOT :
+					    CONFIG_GPS_REPLAY_TTFF_COLD);
+	data->running = true;
+
+	LOG_DBG("Replay started, %s start", hot ? "hot" : "cold");
+
+	k_delayed_work_submit(&data->tick_work, CONFIG_GPS_REPLAY_INTERVAL);
+
+	return 0;
+}
+
+static int replay_stop(struct device *dev)
+{
+	struct replay_data *data = dev->driver_data;
+
+	data->running = false;
+	k_delayed_work_cancel(&data->tick_work);
+
+	return 0;
+}
+
+static int replay_sample_fetch(struct device *dev)
+{
+	return 0;
+}
+
+static int replay_channel_get(struct device *dev, enum gps_channel chan,
+			      struct gps_data *gps_data)
+{
+	struct replay_data *data = dev->driver_data;
+	k_spinlock_key_t key;
+
+	if (chan != GPS_CHAN_PVT) {
+		return -ENOTSUP;
+	}
+
+	key = k_spin_lock(&data->lock);
+	gps_data->pvt = data->pvt;
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static int replay_trigger_set(struct device *dev, struct gps_trigger *trig,
+			      gps_trigger_handler_t handler)
+{
+	struct replay_data *data = dev->driver_data;
+
+	if (trig->type != GPS_TRIG_FIX) {
+		return -ENOTSUP;
+	}
+
+	data->trigger = *trig;
+	data->handler = handler;
+
+	return 0;
+}
+
+static int replay_init(struct device *dev)
+{
+	struct replay_data *data = dev->driver_data;
+
+	data->dev = dev;
+	data->last_fix_ts = -1;
+	k_delayed_work_init(&data->tick_work, tick_work_fn);
+
+	LOG_INF("Replaying %d records", gps_replay_trace_len);
+
+	return 0;
+}
+
+static const struct gps_driver_api replay_api = {
+	.sample_fetch = replay_sample_fetch,
+	.channel_get = replay_channel_get,
+	.trigger_set = replay_trigger_set,
+	.start = replay_start,
+	.stop = replay_stop,
+};
+
+DEVICE_AND_API_INIT(gps_replay, CONFIG_GPS_REPLAY_DEV_NAME, replay_init,
+		    &replay_data, NULL, APPLICATION,
+		    CONFIG_APPLICATION_INIT_PRIORITY, &replay_api);
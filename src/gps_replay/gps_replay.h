@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef GPS_REPLAY_H__
+#define GPS_REPLAY_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One recorded fix. */
+struct gps_replay_record {
+	/** Milliseconds since the first record of the trace. */
+	u32_t ts;
+	double latitude;
+	double longitude;
+	float altitude;
+	float accuracy;
+	float speed;
+	u8_t satellites;
+};
+
+/** Generated from CONFIG_GPS_REPLAY_TRACE by gps_replay_trace.py. */
+extern const s64_t gps_replay_trace_epoch;
+extern const struct gps_replay_record gps_replay_trace[];
+extern const size_t gps_replay_trace_len;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* GPS_REPLAY_H__ */
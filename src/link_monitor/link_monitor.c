@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <at_cmd.h>
+#include <at_notif.h>
+
+#include "link_monitor.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(link_monitor, CONFIG_LINK_MONITOR_LOG_LEVEL);
+
+/* Level 5 adds the PSM timers granted by the network. */
+#define AT_CEREG_SUBSCRIBE	"AT+CEREG=5"
+#define AT_CSCON_SUBSCRIBE	"AT+CSCON=1"
+#define AT_CEDRXS_SUBSCRIBE	"AT+CEDRXS=2,%d,\"%s\""
+
+#define CEREG_NOTIF		"+CEREG:"
+#define CSCON_NOTIF		"+CSCON:"
+#define CEDRXP_NOTIF		"+CEDRXP:"
+
+#define NOTIF_LEN_MAX		128
+#define FIELDS_MAX		10
+
+/* Indices of the +CEREG fields. */
+#define CEREG_STAT		0
+#define CEREG_TAC		1
+#define CEREG_CELL_ID		2
+#define CEREG_ACTIVE_TIME	6
+#define CEREG_PERIODIC_TAU	7
+
+/* Indices of the +CEDRXP fields. */
+#define CEDRXP_NW_EDRX		2
+#define CEDRXP_PTW		3
+
+#define EDRX_ACT_LTE_M		4
+#define EDRX_ACT_NBIOT		5
+
+/* Timer units in seconds, indexed by the three most significant bits of
+ * the timer value. 0 marks a deactivated timer.
+ */
+static const u32_t t3324_units[] = { 2, 60, 360, 60, 60, 60, 60, 0 };
+static const u32_t t3412_units[] = { 600, 3600, 36000, 2, 30, 60, 1152000,
+				     0 };
+
+static struct link_monitor_state state = {
+	.reg_status = LTE_LC_NW_REG_NOT_REGISTERED,
+	.psm_active_time = -1,
+	.psm_periodic_tau = -1,
+};
+static link_monitor_handler_t event_handler;
+
+static struct k_spinlock lock;
+K_SEM_DEFINE(registered_sem, 0, 1);
+
+/* Splits a notification into comma separated fields and strips quotes.
+ * Empty fields are kept, so that field positions are fixed.
+ */
+static size_t fields_split(char *buf, char **fields)
+{
+	size_t count = 0;
+	char *pos = buf;
+
+	while (count < FIELDS_MAX) {
+		char *end = strchr(pos, ',');
+
+		if (end) {
+			*end = '\0';
+		}
+
+		while (*pos == ' ') {
+			pos++;
+		}
+
+		if (*pos == '"') {
+			char *quote = strchr(++pos, '"');
+
+			if (quote) {
+				*quote = '\0';
+			}
+		}
+
+		fields[count++] = pos;
+
+		if (end == NULL) {
+			break;
+		}
+
+		pos = end + 1;
+	}
+
+	return count;
+}
+
+static s32_t timer_decode(const char *bits, const u32_t *units)
+{
+	u32_t value = 0;
+
+	if (strlen(bits) != 8) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < 8; i++) {
+		if (bits[i] != '0' && bits[i] != '1') {
+			return -1;
+		}
+
+		value = (value << 1) | (bits[i] - '0');
+	}
+
+	if (units[value >> 5] == 0) {
+		return -1;
+	}
+
+	return (value & 0x1f) * units[value >> 5];
+}
+
+static bool is_registered(enum lte_lc_nw_reg_status status)
+{
+	return status == LTE_LC_NW_REG_REGISTERED_HOME ||
+	       status == LTE_LC_NW_REG_REGISTERED_ROAMING;
+}
+
+static void event_send(enum link_monitor_evt_type type,
+		       const struct link_monitor_state *snapshot)
+{
+	if (event_handler) {
+		event_handler(type, snapshot);
+	}
+}
+
+static void cereg_parse(char **fields, size_t count)
+{
+	struct link_monitor_state snapshot;
+	bool registration_changed, cell_changed = false;
+	bool psm_changed = false;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	state.reg_status = strtol(fields[CEREG_STAT], NULL, 10);
+	registration_changed = state.registered !=
+			       is_registered(state.reg_status);
+	state.registered = is_registered(state.reg_status);
+
+	if (count > CEREG_CELL_ID &&
+	    strlen(fields[CEREG_TAC]) == LINK_MONITOR_TAC_LEN &&
+	    strlen(fields[CEREG_CELL_ID]) == LINK_MONITOR_CELL_ID_LEN) {
+		cell_changed = strcmp(state.cell_id, fields[CEREG_CELL_ID]);
+
+		strcpy(state.tac, fields[CEREG_TAC]);
+		strcpy(state.cell_id, fields[CEREG_CELL_ID]);
+		state.cell_ts = k_uptime_get();
+	}
+
+	if (count > CEREG_PERIODIC_TAU) {
+		s32_t active_time = timer_decode(fields[CEREG_ACTIVE_TIME],
+						 t3324_units);
+		s32_t tau = timer_decode(fields[CEREG_PERIODIC_TAU],
+					 t3412_units);
+
+		psm_changed = active_time != state.psm_active_time ||
+			      tau != state.psm_periodic_tau;
+		state.psm_active_time = active_time;
+		state.psm_periodic_tau = tau;
+	}
+
+	snapshot = state;
+
+	k_spin_unlock(&lock, key);
+
+	if (registration_changed) {
+		LOG_INF("LTE %s, status %d",
+			snapshot.registered ? "registered" : "deregistered",
+			snapshot.reg_status);
+
+		if (snapshot.registered) {
+			k_sem_give(&registered_sem);
+		} else {
+			k_sem_take(&registered_sem, K_NO_WAIT);
+		}
+
+		event_send(snapshot.registered ? LINK_MONITOR_EVT_REGISTERED :
+			   LINK_MONITOR_EVT_DEREGISTERED, &snapshot);
+	}
+
+	if (cell_changed) {
+		LOG_DBG("Cell %s, tracking area %s",
+			log_strdup(snapshot.cell_id), log_strdup(snapshot.tac));
+		event_send(LINK_MONITOR_EVT_CELL_CHANGED, &snapshot);
+	}
+
+	if (psm_changed) {
+		LOG_INF("PSM active time %d s, periodic TAU %d s",
+			snapshot.psm_active_time, snapshot.psm_periodic_tau);
+		event_send(LINK_MONITOR_EVT_PSM_CHANGED, &snapshot);
+	}
+}
+
+static void cscon_parse(char **fields, size_t count)
+{
+	struct link_monitor_state snapshot;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	state.rrc_connected = strtol(fields[0], NULL, 10) == 1;
+	snapshot = state;
+	k_spin_unlock(&lock, key);
+
+	LOG_DBG("RRC %s", snapshot.rrc_connected ? "connected" : "idle");
+	event_send(LINK_MONITOR_EVT_RRC_CHANGED, &snapshot);
+}
+
+static void cedrxp_parse(char **fields, size_t count)
+{
+	struct link_monitor_state snapshot;
+	k_spinlock_key_t key;
+
+	if (count <= CEDRXP_PTW) {
+		return;
+	}
+
+	key = k_spin_lock(&lock);
+	strncpy(state.edrx, fields[CEDRXP_NW_EDRX], LINK_MONITOR_EDRX_LEN);
+	strncpy(state.ptw, fields[CEDRXP_PTW], LINK_MONITOR_EDRX_LEN);
+	snapshot = state;
+	k_spin_unlock(&lock, key);
+
+	LOG_INF("eDRX %s, PTW %s", log_strdup(snapshot.edrx),
+		log_strdup(snapshot.ptw));
+	event_send(LINK_MONITOR_EVT_EDRX_CHANGED, &snapshot);
+}
+
+static void at_handler(void *context, char *response)
+{
+	static const struct {
+		const char *prefix;
+		void (*parse)(char **fields, size_t count);
+	} parsers[] = {
+		{ CEREG_NOTIF, cereg_parse },
+		{ CSCON_NOTIF, cscon_parse },
+		{ CEDRXP_NOTIF, cedrxp_parse },
+	};
+	char buf[NOTIF_LEN_MAX];
+	char *fields[FIELDS_MAX];
+
+	ARG_UNUSED(context);
+
+	for (size_t i = 0; i < ARRAY_SIZE(parsers); i++) {
+		size_t len = strlen(parsers[i].prefix);
+
+		if (strncmp(response, parsers[i].prefix, len) != 0) {
+			continue;
+		}
+
+		strncpy(buf, response + len, sizeof(buf) - 1);
+		buf[sizeof(buf) - 1] = '\0';
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		parsers[i].parse(fields, fields_split(buf, fields));
+		return;
+	}
+}
+
+static int subscribe(void)
+{
+	int err;
+
+	err = at_cmd_write(AT_CEREG_SUBSCRIBE, NULL, 0, NULL);
+	if (err) {
+		LOG_ERR("Could not subscribe to +CEREG, error: %d", err);
+		return err;
+	}
+
+	err = at_cmd_write(AT_CSCON_SUBSCRIBE, NULL, 0, NULL);
+	if (err) {
+		LOG_ERR("Could not subscribe to +CSCON, error: %d", err);
+		return err;
+	}
+
+#if defined(CONFIG_LINK_MONITOR_EDRX_NOTIFICATIONS)
+	char cmd[sizeof(AT_CEDRXS_SUBSCRIBE) + LINK_MONITOR_EDRX_LEN];
+	int act = IS_ENABLED(CONFIG_LTE_NETWORK_MODE_NBIOT) ||
+		  IS_ENABLED(CONFIG_LTE_NETWORK_MODE_NBIOT_GPS) ?
+		  EDRX_ACT_NBIOT : EDRX_ACT_LTE_M;
+
+	snprintf(cmd, sizeof(cmd), AT_CEDRXS_SUBSCRIBE, act,
+		 CONFIG_LTE_EDRX_REQ_VALUE);
+
+	err = at_cmd_write(cmd, NULL, 0, NULL);
+	if (err) {
+		LOG_ERR("Could not subscribe to +CEDRXP, error: %d", err);
+		return err;
+	}
+#endif
+
+	return 0;
+}
+
+int link_monitor_init(link_monitor_handler_t handler)
+{
+	enum lte_lc_nw_reg_status status;
+	k_spinlock_key_t key;
+	int err;
+
+	event_handler = handler;
+
+	err = at_notif_register_handler(NULL, at_handler);
+	if (err) {
+		LOG_ERR("Could not register notification handler, error: %d",
+			err);
+		return err;
+	}
+
+	err = subscribe();
+	if (err) {
+		return err;
+	}
+
+	/* Notifications only report changes, the initial status is read
+	 * once.
+	 */
+	err = lte_lc_nw_reg_status_get(&status);
+	if (err) {
+		LOG_ERR("lte_lc_nw_reg_status_get, error: %d", err);
+		return err;
+	}
+
+	key = k_spin_lock(&lock);
+	state.reg_status = status;
+	state.registered = is_registered(status);
+	k_spin_unlock(&lock, key);
+
+	if (is_registered(status)) {
+		k_sem_give(&registered_sem);
+	}
+
+	return 0;
+}
+
+bool link_monitor_is_registered(void)
+{
+	return state.registered;
+}
+
+int link_monitor_wait_registered(s32_t timeout)
+{
+	if (k_sem_take(&registered_sem, timeout)) {
+		return -EAGAIN;
+	}
+
+	/* Leave the semaphore given for other waiters. */
+	k_sem_give(&registered_sem);
+
+	return 0;
+}
+
+void link_monitor_state_get(struct link_monitor_state *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*out = state;
+
+	k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef LINK_MONITOR_H__
+#define LINK_MONITOR_H__
+
+#include <zephyr.h>
+#include <lte_lc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINK_MONITOR_TAC_LEN		4
+#define LINK_MONITOR_CELL_ID_LEN	8
+#define LINK_MONITOR_EDRX_LEN		4
+
+enum link_monitor_evt_type {
+	LINK_MONITOR_EVT_REGISTERED,
+	LINK_MONITOR_EVT_DEREGISTERED,
+	LINK_MONITOR_EVT_CELL_CHANGED,
+	LINK_MONITOR_EVT_PSM_CHANGED,
+	LINK_MONITOR_EVT_EDRX_CHANGED,
+	LINK_MONITOR_EVT_RRC_CHANGED,
+};
+
+struct link_monitor_state {
+	enum lte_lc_nw_reg_status reg_status;
+	bool registered;
+	/** Tracking area code and cell ID, hexadecimal strings. */
+	char tac[LINK_MONITOR_TAC_LEN + 1];
+	char cell_id[LINK_MONITOR_CELL_ID_LEN + 1];
+	/** Uptime of the last cell update. */
+	s64_t cell_ts;
+	/** PSM timers granted by the network in seconds, -1 if PSM is not
+	 *  granted.
+	 */
+	s32_t psm_active_time;
+	s32_t psm_periodic_tau;
+	/** eDRX value and paging time window granted by the network, as
+	 *  reported in +CEDRXP. Empty if eDRX is not in use.
+	 */
+	char edrx[LINK_MONITOR_EDRX_LEN + 1];
+	char ptw[LINK_MONITOR_EDRX_LEN + 1];
+	bool rrc_connected;
+};
+
+/**
+ * @brief Called from the AT notification context, must not block.
+ */
+typedef void (*link_monitor_handler_t)(enum link_monitor_evt_type type,
+				       const struct link_monitor_state *state);
+
+/**
+ * @brief Subscribes to registration, RRC and eDRX notifications and reads
+ *	  the current registration status once.
+ *
+ * @param handler Called on changes of the link state.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int link_monitor_init(link_monitor_handler_t handler);
+
+/**
+ * @brief Returns true if registered to a home or roaming network.
+ */
+bool link_monitor_is_registered(void);
+
+/**
+ * @brief Waits until registered to a network.
+ *
+ * @param timeout Time to wait in milliseconds, or K_FOREVER.
+ *
+ * @return 0 when registered, -EAGAIN on timeout.
+ */
+int link_monitor_wait_registered(s32_t timeout);
+
+/**
+ * @brief Gets a copy of the current link state.
+ */
+void link_monitor_state_get(struct link_monitor_state *state);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LINK_MONITOR_H__ */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "log_bench.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(log_bench, CONFIG_LOG_BENCH_LOG_LEVEL);
+
+/* Time for the logging thread to drain the messages of one measurement
+ * when logging is deferred.
+ */
+#define DRAIN_TIME	K_MSEC(500)
+
+/* The strdup buffers are only freed when the messages are processed, so
+ * calls beyond their number would time the allocation failure path.
+ */
+#if !defined(CONFIG_LOG_IMMEDIATE)
+BUILD_ASSERT_MSG(CONFIG_LOG_BENCH_ITERATIONS <= CONFIG_LOG_STRDUP_BUF_COUNT,
+		 "LOG_BENCH_ITERATIONS exceeds LOG_STRDUP_BUF_COUNT");
+#endif
+
+static void log_plain(u32_t i)
+{
+	LOG_INF("log_bench");
+}
+
+static void log_args(u32_t i)
+{
+	LOG_INF("log_bench %d %d", i, i * 2);
+}
+
+static void log_string(u32_t i)
+{
+	char buf[16];
+
+	snprintf(buf, sizeof(buf), "entry %d", i);
+	LOG_INF("log_bench %s", log_strdup(buf));
+}
+
+/* Compiled in but rejected by the level check at runtime, unless the
+ * module level is DBG.
+ */
+static void log_filtered(u32_t i)
+{
+	LOG_DBG("log_bench %d", i);
+}
+
+static const struct {
+	const char *name;
+	void (*fn)(u32_t i);
+} cases[] = {
+	{ "plain", log_plain },
+	{ "args", log_args },
+	{ "strdup", log_string },
+	{ "filtered", log_filtered },
+};
+
+/* The loop is timed as a whole, as a single call can be shorter than one
+ * cycle of the system clock, which is the 32768 Hz RTC on nRF9160.
+ */
+static u64_t ns_per_call(void (*fn)(u32_t i))
+{
+	u32_t start = k_cycle_get_32();
+
+	for (u32_t i = 0; i < CONFIG_LOG_BENCH_ITERATIONS; i++) {
+		fn(i);
+	}
+
+	return SYS_CLOCK_HW_CYCLES_TO_NS64(k_cycle_get_32() - start) /
+	       CONFIG_LOG_BENCH_ITERATIONS;
+}
+
+void log_bench_run(void)
+{
+	printk("log_bench: %s mode, %d calls per case, %u ns resolution\n",
+	       IS_ENABLED(CONFIG_LOG_IMMEDIATE) ? "immediate" : "deferred",
+	       CONFIG_LOG_BENCH_ITERATIONS,
+	       (u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(1) /
+		       CONFIG_LOG_BENCH_ITERATIONS));
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		u64_t ns;
+
+		k_sleep(DRAIN_TIME);
+		ns = ns_per_call(cases[i].fn);
+
+		printk("log_bench: %-8s %u ns/call\n", cases[i].name,
+		       (u32_t)ns);
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_log_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(shell);
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	log_bench_run();
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(log_bench, NULL, "Measure the cost of log calls",
+		   cmd_log_bench);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef LOG_BENCH_H__
+#define LOG_BENCH_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_LOG_BENCH)
+/**
+ * @brief Measures the average cost of typical log calls in the caller's
+ *	  context and prints the results with printk.
+ */
+void log_bench_run(void);
+#else
+static inline void log_bench_run(void)
+{
+}
+#endif /* CONFIG_LOG_BENCH */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* LOG_BENCH_H__ */
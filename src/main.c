@@ -7,13 +7,32 @@
 #include <sensor.h>
 #include <drivers/gps.h>
 #include <gps_controller.h>
+#include <fix_selection.h>
+#include <track_simplify.h>
+#if defined(CONFIG_GEOFENCE)
+#include <geofence.h>
+#endif
 #include <ui.h>
 #include <net/cloud.h>
 #include <cloud_codec.h>
+#include <cfg_store.h>
+#include <mem_track.h>
+#include <stack_monitor.h>
+#include <app_trace.h>
+#include <metrics.h>
 #include <lte_lc.h>
 #include <stdlib.h>
 #include <modem_info.h>
+#include <modem_cache.h>
+#include <link_monitor.h>
+#include <boot_seq.h>
+#include <log_bench.h>
+#include <event_bus.h>
+#include <snapshot.h>
 #include <time.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
 #include <net/socket.h>
 #include <dfu/mcuboot.h>
 #include <nrf9160_timestamp.h>
@@ -28,13 +47,29 @@ LOG_MODULE_REGISTER(cat_tracker, CONFIG_CAT_TRACKER_LOG_LEVEL);
 #define CFG_TOPIC_LEN (AWS_LEN + AWS_CLOUD_CLIENT_ID_LEN + 32)
 #define BATCH_TOPIC "%s/batch"
 #define BATCH_TOPIC_LEN (AWS_CLOUD_CLIENT_ID_LEN + 6)
+#define MSG_BUF_RETRY_DELAY K_SECONDS(2)
+/* Longest time the FOTA reboot waits for a message buffer to send the
+ * buffered fixes.
+ */
+#define FOTA_REBOOT_TIMEOUT K_SECONDS(30)
+
+static struct cloud_data_gps cir_buf_gps[CONFIG_CIRCULAR_SENSOR_BUFFER_MAX];
 
-enum lte_conn_actions {
-	LTE_INIT,
-	CHECK_LTE_CONNECTION,
+struct acc_sample {
+	double acc[3];
+	s64_t timestamp;
 };
 
-static struct cloud_data_gps cir_buf_gps[CONFIG_CIRCULAR_SENSOR_BUFFER_MAX];
+struct gps_sample {
+	struct cloud_data_gps fix;
+	int idx;
+};
+
+/* Latest samples for the sensor data encoder, which runs in the system
+ * workqueue while the samples are updated by other threads.
+ */
+SNAPSHOT_DEFINE(acc_snapshot, struct acc_sample);
+SNAPSHOT_DEFINE(gps_snapshot, struct gps_sample);
 
 static struct cloud_data cloud_data = {
 				.gps_timeout = 60,
@@ -49,6 +84,10 @@ static struct cloud_endpoint sub_ep_topics_sub[1];
 static struct cloud_endpoint pub_ep_topics_sub[1];
 
 static char client_id_buf[AWS_CLOUD_CLIENT_ID_LEN + 1];
+
+BUILD_ASSERT_MSG(sizeof(CONFIG_CLOUD_CLIENT_ID) <= sizeof(client_id_buf),
+		 "CONFIG_CLOUD_CLIENT_ID is too long");
+
 static char batch_topic[BATCH_TOPIC_LEN + 1];
 static char cfg_topic[CFG_TOPIC_LEN + 1];
 
@@ -70,14 +109,55 @@ static struct k_delayed_work cloud_send_cfg_work;
 static struct k_delayed_work cloud_send_buffered_data_work;
 static struct k_delayed_work set_led_device_mode_work;
 static struct k_delayed_work movement_timeout_work;
+static struct k_delayed_work fota_reboot_work;
+static s64_t fota_reboot_deadline;
+#if defined(CONFIG_METRICS)
+static struct k_delayed_work cloud_send_metrics_work;
+#endif
+#if defined(CONFIG_GEOFENCE)
+static struct k_delayed_work cloud_send_geofence_event_work;
+
+K_MSGQ_DEFINE(geofence_evt_msgq, sizeof(struct geofence_event),
+	      CONFIG_GEOFENCE_MAX_FENCES, 4);
+#endif
 
 K_SEM_DEFINE(accel_trig_sem, 0, 1);
 K_SEM_DEFINE(gps_timeout_sem, 0, 1);
-K_SEM_DEFINE(cloud_conn_sem, 0, 1);
+K_SEM_DEFINE(cfg_changed_sem, 0, 1);
+K_SEM_DEFINE(fix_request_sem, 0, 1);
+
+/* Events ending the wait between GPS searches. Motion is last, as it is
+ * only polled for once the sleep interval has passed.
+ */
+enum wake_event {
+	WAKE_CFG_CHANGED,
+	WAKE_FIX_REQUEST,
+	WAKE_MOTION,
+
+	WAKE_EVENT_COUNT
+};
+
+static struct k_poll_event wake_events[WAKE_EVENT_COUNT] = {
+	[WAKE_CFG_CHANGED] = K_POLL_EVENT_STATIC_INITIALIZER(
+		K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY,
+		&cfg_changed_sem, 0),
+	[WAKE_FIX_REQUEST] = K_POLL_EVENT_STATIC_INITIALIZER(
+		K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY,
+		&fix_request_sem, 0),
+	[WAKE_MOTION] = K_POLL_EVENT_STATIC_INITIALIZER(
+		K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY,
+		&accel_trig_sem, 0),
+};
+
+/* Cycle count when the last configuration change was published. */
+static u32_t cfg_changed_cycles;
+/* Period movement_timeout_work is currently scheduled with. */
+static int movement_timeout;
 
 void error_handler(int err_code)
 {
 	LOG_ERR("err_handler, error code: %d", err_code);
+	metrics_reboot_reason_set(err_code);
 	ui_led_set_pattern(UI_LED_ERROR_SYSTEM_FAULT);
 
 #if !defined(CONFIG_DEBUG) && defined(CONFIG_REBOOT)
@@ -101,66 +181,53 @@ void k_sys_fatal_error_handler(unsigned int reason, const z_arch_esf_t *esf)
 
 	LOG_PANIC();
 	LOG_ERR("k_sys_fatal_error_handler, error: %d", reason);
+	metrics_reboot_reason_set(METRICS_REBOOT_FATAL_BASE + reason);
 	error_handler(reason);
 	CODE_UNREACHABLE;
 }
 
-static int lte_connect(enum lte_conn_actions action)
+static int lte_init(void)
 {
-	int err;
-
-	enum lte_lc_nw_reg_status nw_reg_status;
-
 	ui_led_set_pattern(UI_LTE_CONNECTING);
 
-	if (action == LTE_INIT) {
-		if (IS_ENABLED(CONFIG_LTE_AUTO_INIT_AND_CONNECT)) {
-			/* Do nothing, modem is already turned on
-			 * and connected.
-			 */
-		} else {
-			LOG_INF("Connecting to LTE network. ");
-			LOG_INF("This may take several minutes.");
-			err = lte_lc_init_and_connect();
-			if (err == -ETIMEDOUT) {
-				goto exit;
-			} else if (err) {
-				return err;
-			}
-		}
-	} else if (action == CHECK_LTE_CONNECTION) {
-		err = lte_lc_nw_reg_status_get(&nw_reg_status);
-		if (err) {
-			LOG_ERR("lte_lc_nw_reg_status error: %d", err);
-			error_handler(err);
-		}
-
-		LOG_INF("Checking LTE connection...");
-
-		switch (nw_reg_status) {
-		case LTE_LC_NW_REG_REGISTERED_HOME:
-		case LTE_LC_NW_REG_REGISTERED_ROAMING:
-			break;
-		default:
-			goto exit;
-		}
+	if (IS_ENABLED(CONFIG_LTE_AUTO_INIT_AND_CONNECT)) {
+		/* Do nothing, modem is already turned on
+		 * and connected.
+		 */
+		return 0;
 	}
 
-	LOG_INF("Connected to LTE network");
-
-	k_sem_give(&cloud_conn_sem);
-
-	return 0;
-
-exit:
+	return lte_lc_init();
+}
 
-	LOG_ERR("LTE link could not be established, or maintained");
+/* Attaching may take minutes in bad coverage, the rest of the boot
+ * sequence continues meanwhile and waits for link monitor events.
+ */
+static void lte_attach(void)
+{
+	int err;
 
-	k_sem_take(&cloud_conn_sem, K_NO_WAIT);
+	if (IS_ENABLED(CONFIG_LTE_AUTO_INIT_AND_CONNECT)) {
+		return;
+	}
 
-	return 0;
+	LOG_INF("Connecting to LTE network. ");
+	LOG_INF("This may take several minutes.");
+	err = lte_lc_connect();
+	if (err == -ETIMEDOUT) {
+		/* The modem keeps searching, the link monitor reports
+		 * a later registration.
+		 */
+		LOG_ERR("LTE link could not be established");
+	} else if (err) {
+		LOG_ERR("lte_lc_connect, error: %d", err);
+		error_handler(err);
+	}
 }
 
+K_THREAD_DEFINE(lte_attach_thread, CONFIG_LTE_ATTACH_STACKSIZE, lte_attach,
+		NULL, NULL, NULL, CONFIG_LTE_ATTACH_PRIORITY, 0, K_FOREVER);
+
 static int check_active_wait(void)
 {
 	if (!cloud_data.active) {
@@ -170,16 +237,16 @@ static int check_active_wait(void)
 	return cloud_data.active_wait;
 }
 
-static void set_current_time(struct gps_data gps_data)
+static void set_current_time(const struct gps_pvt *pvt)
 {
 	struct tm gps_time;
 
-	gps_time.tm_year = gps_data.pvt.datetime.year;
-	gps_time.tm_mon = gps_data.pvt.datetime.month;
-	gps_time.tm_mday = gps_data.pvt.datetime.day;
-	gps_time.tm_hour = gps_data.pvt.datetime.hour;
-	gps_time.tm_min = gps_data.pvt.datetime.minute;
-	gps_time.tm_sec = gps_data.pvt.datetime.seconds;
+	gps_time.tm_year = pvt->datetime.year;
+	gps_time.tm_mon = pvt->datetime.month;
+	gps_time.tm_mday = pvt->datetime.day;
+	gps_time.tm_hour = pvt->datetime.hour;
+	gps_time.tm_min = pvt->datetime.minute;
+	gps_time.tm_sec = pvt->datetime.seconds;
 
 	date_time_set(&gps_time);
 }
@@ -206,36 +273,81 @@ static double get_accel_thres(void)
 	return accel_threshold_double;
 }
 
-static void populate_gps_buffer(struct gps_data gps_data)
+static void gps_snapshot_publish(void)
 {
+	struct gps_sample sample = {
+		.fix = cir_buf_gps[head_cir_buf],
+		.idx = head_cir_buf,
+	};
+
+	snapshot_publish(&gps_snapshot, &sample);
+}
+
+static void populate_gps_buffer(const struct gps_pvt *pvt)
+{
+	int prev_cir_buf;
+	struct cloud_data_gps fix = {
+		.longitude = pvt->longitude,
+		.latitude = pvt->latitude,
+		.altitude = pvt->altitude,
+		.accuracy = pvt->accuracy,
+		.speed = pvt->speed,
+		.heading = pvt->heading,
+		.gps_timestamp = k_uptime_get(),
+		.queued = true
+	};
+	enum track_simplify_action action;
+
 	cloud_data.gps_found = true;
+	metrics_counter_inc(METRICS_GPS_FIXES);
+
+	prev_cir_buf = head_cir_buf == 0 ?
+		       CONFIG_CIRCULAR_SENSOR_BUFFER_MAX - 1 : head_cir_buf - 1;
 
-	head_cir_buf += 1;
-	if (head_cir_buf == CONFIG_CIRCULAR_SENSOR_BUFFER_MAX - 1) {
-		head_cir_buf = 0;
+	action = track_simplify_check(cir_buf_gps[prev_cir_buf].queued ?
+				      &cir_buf_gps[prev_cir_buf] : NULL,
+				      &cir_buf_gps[head_cir_buf], &fix);
+
+	switch (action) {
+	case TRACK_SIMPLIFY_MERGE:
+		track_simplify_merge(&cir_buf_gps[head_cir_buf], &fix);
+		LOG_INF("Entry: %d in gps_buffer extended", head_cir_buf);
+		gps_snapshot_publish();
+		return;
+	case TRACK_SIMPLIFY_REPLACE:
+		LOG_INF("Entry: %d in gps_buffer on path, replaced",
+			head_cir_buf);
+		break;
+	case TRACK_SIMPLIFY_APPEND:
+		head_cir_buf += 1;
+		if (head_cir_buf == CONFIG_CIRCULAR_SENSOR_BUFFER_MAX) {
+			head_cir_buf = 0;
+		}
+
+		if (cir_buf_gps[head_cir_buf].queued) {
+			LOG_WRN("Entry: %d in gps_buffer overwritten",
+				head_cir_buf);
+			metrics_counter_inc(METRICS_GPS_DROPPED);
+		}
+		break;
 	}
 
-	cir_buf_gps[head_cir_buf].longitude = gps_data.pvt.longitude;
-	cir_buf_gps[head_cir_buf].latitude = gps_data.pvt.latitude;
-	cir_buf_gps[head_cir_buf].altitude = gps_data.pvt.altitude;
-	cir_buf_gps[head_cir_buf].accuracy = gps_data.pvt.accuracy;
-	cir_buf_gps[head_cir_buf].speed = gps_data.pvt.speed;
-	cir_buf_gps[head_cir_buf].heading = gps_data.pvt.heading;
-	cir_buf_gps[head_cir_buf].gps_timestamp = k_uptime_get();
-	cir_buf_gps[head_cir_buf].queued = true;
+	cir_buf_gps[head_cir_buf] = fix;
 
 	LOG_INF("Entry: %d in gps_buffer filled", head_cir_buf);
+
+	gps_snapshot_publish();
 }
 
 static int get_voltage_level(void)
 {
 	int err;
 
-	/* This solution of requesting all modem parameters should
-	   be replaced with only requesting battery */
-	err = modem_info_params_get(&modem_param);
+	APP_TRACE_BEGIN(APP_TRACE_MODEM_INFO);
+	err = modem_cache_update(MODEM_CACHE_BATTERY);
+	APP_TRACE_END(APP_TRACE_MODEM_INFO);
 	if (err) {
-		LOG_ERR("modem_info_params_get, error: %d", err);
+		LOG_ERR("modem_cache_update, error: %d", err);
 		return err;
 	}
 
@@ -245,14 +357,17 @@ static int get_voltage_level(void)
 	return 0;
 }
 
-static int modem_data_get(void)
+static int modem_data_get(bool include_dev_data)
 {
 	int err;
 
 	cloud_data.roam_modem_data_ts = k_uptime_get();
 	cloud_data.dev_modem_data_ts = k_uptime_get();
 
-	err = modem_info_params_get(&modem_param);
+	APP_TRACE_BEGIN(APP_TRACE_MODEM_INFO);
+	err = modem_cache_update(MODEM_CACHE_NETWORK |
+				 (include_dev_data ? MODEM_CACHE_DEVICE : 0));
+	APP_TRACE_END(APP_TRACE_MODEM_INFO);
 	if (err) {
 		LOG_ERR("Error getting modem_info: %d", err);
 		return err;
@@ -261,6 +376,28 @@ static int modem_data_get(void)
 	return 0;
 }
 
+static int cloud_publish(struct cloud_msg *msg)
+{
+	s64_t start = k_uptime_get();
+	int err;
+
+	APP_TRACE_BEGIN(APP_TRACE_CLOUD_SEND);
+	err = cloud_send(cloud_backend, msg);
+	APP_TRACE_END(APP_TRACE_CLOUD_SEND);
+
+	if (err) {
+		metrics_counter_inc(METRICS_PUBLISH_FAILED);
+		return err;
+	}
+
+	metrics_counter_inc(METRICS_PUBLISH_OK);
+	metrics_counter_add(METRICS_PUBLISH_BYTES, msg->len);
+	metrics_histogram_add(METRICS_PUBLISH_LATENCY,
+			      k_uptime_get() - start);
+
+	return 0;
+}
+
 static void cloud_config_get(void)
 {
 	int err;
@@ -272,7 +409,7 @@ static void cloud_config_get(void)
 				 .buf = "",
 				 .len = 0 };
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_publish(&msg);
 	if (err) {
 		LOG_ERR("Cloud send failed, err: %d", err);
 	}
@@ -289,16 +426,22 @@ static void cloud_send_cfg(void)
 		.endpoint.type = CLOUD_EP_TOPIC_MSG,
 	};
 
+	APP_TRACE_BEGIN(APP_TRACE_ENCODE);
 	err = cloud_encode_cfg_data(&msg, &cloud_data);
+	APP_TRACE_END(APP_TRACE_ENCODE);
 	if (err == -EAGAIN) {
 		LOG_INF("No change in device configuration");
 		return;
+	} else if (err == -ENOBUFS) {
+		k_delayed_work_submit(&cloud_send_cfg_work,
+				      MSG_BUF_RETRY_DELAY);
+		return;
 	} else if (err) {
 		LOG_ERR("Device configuration not encoded, error: %d", err);
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_publish(&msg);
 	cloud_release_data(&msg);
 	if (err) {
 		LOG_ERR("Cloud send failed, err: %d", err);
@@ -309,6 +452,9 @@ static void cloud_send_cfg(void)
 static void cloud_send_sensor_data(void)
 {
 	int err;
+	struct cloud_data data;
+	struct acc_sample acc;
+	struct gps_sample gps;
 
 	ui_led_set_pattern(UI_CLOUD_PUBLISHING);
 
@@ -323,22 +469,35 @@ static void cloud_send_sensor_data(void)
 		return;
 	}
 
-	err = cloud_encode_sensor_data(&msg, &cloud_data,
-				       &cir_buf_gps[head_cir_buf]);
-	if (err) {
+	data = cloud_data;
+	snapshot_read(&acc_snapshot, &acc);
+	memcpy(data.acc, acc.acc, sizeof(data.acc));
+	data.acc_timestamp = acc.timestamp;
+	snapshot_read(&gps_snapshot, &gps);
+
+	APP_TRACE_BEGIN(APP_TRACE_ENCODE);
+	err = cloud_encode_sensor_data(&msg, &data, &gps.fix);
+	APP_TRACE_END(APP_TRACE_ENCODE);
+	if (err == -ENOBUFS) {
+		k_delayed_work_submit(&cloud_send_sensor_data_work,
+				      MSG_BUF_RETRY_DELAY);
+		return;
+	} else if (err) {
 		LOG_ERR("Error enconding message %d", err);
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_publish(&msg);
 	cloud_release_data(&msg);
 	if (err) {
 		LOG_ERR("Cloud send failed, err: %d", err);
 		return;
 	}
 
+	boot_seq_mark(BOOT_PHASE_FIRST_PUBLISH);
+
 	cloud_data.gps_found = false;
-	cir_buf_gps[head_cir_buf].queued = false;
+	cir_buf_gps[gps.idx].queued = false;
 }
 
 static void cloud_send_modem_data(bool include_dev_data)
@@ -352,20 +511,28 @@ static void cloud_send_modem_data(bool include_dev_data)
 		.endpoint.type = CLOUD_EP_TOPIC_MSG,
 	};
 
-	err = modem_data_get();
+	err = modem_data_get(include_dev_data);
 	if (err) {
 		LOG_ERR("modem_data_get, error: %d", err);
 		return;
 	}
 
+	APP_TRACE_BEGIN(APP_TRACE_ENCODE);
 	err = cloud_encode_modem_data(&msg, &cloud_data, &modem_param,
 				      include_dev_data, rsrp);
-	if (err) {
+	APP_TRACE_END(APP_TRACE_ENCODE);
+	if (err == -ENOBUFS) {
+		k_delayed_work_submit(include_dev_data ?
+				      &cloud_send_modem_data_work :
+				      &cloud_send_modem_data_dyn_work,
+				      MSG_BUF_RETRY_DELAY);
+		return;
+	} else if (err) {
 		LOG_ERR("Error encoding modem data, error: %d", err);
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_publish(&msg);
 	cloud_release_data(&msg);
 	if (err) {
 		LOG_ERR("Cloud send failed, err: %d", err);
@@ -373,9 +540,16 @@ static void cloud_send_modem_data(bool include_dev_data)
 	}
 }
 
-static void cloud_send_buffered_data(void)
+BUILD_ASSERT_MSG(CONFIG_CIRCULAR_SENSOR_BUFFER_MAX <= 32,
+		 "GPS buffer entries are tracked in a 32-bit mask");
+
+/* Returns -ENOBUFS if no message buffer was free, and the remaining
+ * entries are sent by cloud_send_buffered_data_work.
+ */
+static int cloud_send_buffered_data(void)
 {
-	int err;
+	int err = 0;
+	u32_t encoded;
 
 	ui_led_set_pattern(UI_CLOUD_PUBLISHING);
 
@@ -394,37 +568,183 @@ static void cloud_send_buffered_data(void)
 
 	/* Encode and send queued entries in batches. */
 	while (num_queued_entries > 0 && queued_entries) {
-		err = cloud_encode_gps_buffer(&msg, cir_buf_gps);
-		if (err) {
+		APP_TRACE_BEGIN(APP_TRACE_ENCODE);
+		err = cloud_encode_gps_buffer(&msg, cir_buf_gps, &encoded);
+		APP_TRACE_END(APP_TRACE_ENCODE);
+		if (err == -ENOBUFS) {
+			k_delayed_work_submit(&cloud_send_buffered_data_work,
+					      MSG_BUF_RETRY_DELAY);
+			goto exit;
+		} else if (err) {
 			LOG_ERR("Error encoding circular buffer: %d", err);
 			goto exit;
 		}
 
-		err = cloud_send(cloud_backend, &msg);
+		err = cloud_publish(&msg);
 		cloud_release_data(&msg);
 		if (err) {
 			LOG_ERR("Cloud send failed, err: %d", err);
 			goto exit;
 		}
 
-		num_queued_entries -= CONFIG_CIRCULAR_SENSOR_BUFFER_MAX;
+		/* Entries are only dequeued once they have been sent. */
+		for (int i = 0; i < CONFIG_CIRCULAR_SENSOR_BUFFER_MAX; i++) {
+			if (encoded & BIT(i)) {
+				cir_buf_gps[i].queued = false;
+			}
+		}
+
+		num_queued_entries -= CONFIG_MAX_PER_ENCODED_ENTRIES;
 	}
 
 exit:
 	num_queued_entries = 0;
 	queued_entries = false;
+
+	return err;
+}
+
+#if defined(CONFIG_GEOFENCE)
+static void cloud_send_geofence_events(void)
+{
+	int err;
+	struct geofence_event evt;
+
+	ui_led_set_pattern(UI_CLOUD_PUBLISHING);
+
+	while (k_msgq_peek(&geofence_evt_msgq, &evt) == 0) {
+		struct cloud_msg msg = {
+			.qos = CLOUD_QOS_AT_MOST_ONCE,
+			.endpoint.type = CLOUD_EP_TOPIC_MSG,
+		};
+
+		APP_TRACE_BEGIN(APP_TRACE_ENCODE);
+		err = cloud_encode_geofence_event(&msg, &evt);
+		APP_TRACE_END(APP_TRACE_ENCODE);
+		if (err == -ENOBUFS) {
+			k_delayed_work_submit(&cloud_send_geofence_event_work,
+					      MSG_BUF_RETRY_DELAY);
+			return;
+		} else if (err) {
+			LOG_ERR("Error encoding geofence event, error: %d",
+				err);
+			return;
+		}
+
+		err = cloud_publish(&msg);
+		cloud_release_data(&msg);
+		if (err) {
+			LOG_ERR("Cloud send failed, err: %d", err);
+			return;
+		}
+
+		k_msgq_get(&geofence_evt_msgq, &evt, K_NO_WAIT);
+	}
+}
+
+static void geofence_event_handler(const struct geofence_event *evt)
+{
+	struct geofence_event dropped;
+
+	/* Keep the latest events if the link has been down for long. */
+	while (k_msgq_put(&geofence_evt_msgq, evt, K_NO_WAIT)) {
+		k_msgq_get(&geofence_evt_msgq, &dropped, K_NO_WAIT);
+	}
+
+	if (link_monitor_is_registered() && cloud_connected) {
+		k_delayed_work_submit(&cloud_send_geofence_event_work,
+				      K_NO_WAIT);
+	}
+}
+#endif
+
+#if defined(CONFIG_METRICS)
+static void cloud_send_metrics(void)
+{
+	int err;
+	struct metrics_snapshot snapshot;
+	struct cloud_msg msg = {
+		.qos = CLOUD_QOS_AT_MOST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG,
+	};
+
+#if defined(CONFIG_MEM_TRACK)
+	struct mem_track_heap_info heap_info;
+
+	if (!mem_track_heap_info_get(&heap_info)) {
+		metrics_gauge_set(METRICS_HEAP_USED, heap_info.used);
+	}
+#endif
+
+	metrics_snapshot_get(&snapshot);
+
+	APP_TRACE_BEGIN(APP_TRACE_ENCODE);
+	err = cloud_encode_metrics(&msg, &snapshot);
+	APP_TRACE_END(APP_TRACE_ENCODE);
+	if (err == -ENOBUFS) {
+		k_delayed_work_submit(&cloud_send_metrics_work,
+				      MSG_BUF_RETRY_DELAY);
+		return;
+	} else if (err) {
+		LOG_ERR("Error encoding metrics, error: %d", err);
+		return;
+	}
+
+	err = cloud_publish(&msg);
+	cloud_release_data(&msg);
+	if (err) {
+		LOG_ERR("Cloud send failed, err: %d", err);
+		return;
+	}
+
+	metrics_reported(&snapshot);
 }
+#endif
 
 static void cloud_synchronize(void)
 {
+	/* Desired changes made while offline are only in the full document,
+	 * a reply with the version already applied is dropped before parsing.
+	 */
 	k_delayed_work_submit(&cloud_config_get_work, K_NO_WAIT);
+
 	k_delayed_work_submit(&cloud_send_cfg_work, K_SECONDS(5));
 	k_delayed_work_submit(&cloud_send_modem_data_work, K_SECONDS(5));
 }
 
+static bool cloud_update_throttled(void)
+{
+#if defined(CONFIG_GEOFENCE)
+	static int home_cycles;
+
+	if (!geofence_is_home()) {
+		home_cycles = 0;
+		return false;
+	}
+
+	if (home_cycles++ % CONFIG_GEOFENCE_HOME_REPORT_DIVIDER) {
+		LOG_INF("Inside home fence, skipping routine update");
+		return true;
+	}
+#endif
+	return false;
+}
+
 static void cloud_update(void)
 {
-	if (k_sem_count_get(&cloud_conn_sem) && cloud_connected) {
+#if defined(CONFIG_GEOFENCE)
+	if (link_monitor_is_registered() && cloud_connected &&
+	    k_msgq_num_used_get(&geofence_evt_msgq)) {
+		k_delayed_work_submit(&cloud_send_geofence_event_work,
+				      K_NO_WAIT);
+	}
+#endif
+
+	if (cloud_update_throttled()) {
+		return;
+	}
+
+	if (link_monitor_is_registered() && cloud_connected) {
 		k_delayed_work_submit(&cloud_send_sensor_data_work,
 				      K_NO_WAIT);
 		k_delayed_work_submit(&cloud_send_cfg_work,
@@ -433,8 +753,18 @@ static void cloud_update(void)
 				      K_SECONDS(5));
 		k_delayed_work_submit(&cloud_send_buffered_data_work,
 				      K_SECONDS(5));
-		k_delayed_work_submit(&set_led_device_mode_work,
-				      K_SECONDS(5));
+
+#if defined(CONFIG_METRICS)
+		if (metrics_publish_due()) {
+			k_delayed_work_submit(&cloud_send_metrics_work,
+					      K_SECONDS(10));
+		}
+#endif
+
+		if (ui_led_is_active()) {
+			k_delayed_work_submit(&set_led_device_mode_work,
+					      K_SECONDS(5));
+		}
 	}
 }
 
@@ -473,16 +803,58 @@ static void cloud_send_buffered_data_work_fn(struct k_work *work)
 	cloud_send_buffered_data();
 }
 
+#if defined(CONFIG_METRICS)
+static void cloud_send_metrics_work_fn(struct k_work *work)
+{
+	cloud_send_metrics();
+}
+#endif
+
+#if defined(CONFIG_GEOFENCE)
+static void cloud_send_geofence_event_work_fn(struct k_work *work)
+{
+	cloud_send_geofence_events();
+}
+#endif
+
+static void movement_timeout_schedule(void)
+{
+	movement_timeout = cloud_data.movement_timeout;
+	k_delayed_work_submit(&movement_timeout_work,
+			      K_SECONDS(movement_timeout));
+}
+
 static void movement_timeout_work_fn(struct k_work *work)
 {
 	if (!cloud_data.active) {
 		LOG_INF("Movement timeout triggered");
-		lte_connect(CHECK_LTE_CONNECTION);
 		cloud_update();
 	}
 
-	k_delayed_work_submit(&movement_timeout_work,
-			      K_SECONDS(cloud_data.movement_timeout));
+	movement_timeout_schedule();
+}
+
+/* Runs on the system workqueue after the publishes already queued, so
+ * that buffered fixes and configuration changes survive the reboot into
+ * the new image. While message buffers are in use the reboot is retried,
+ * until FOTA_REBOOT_TIMEOUT after the download finished.
+ */
+static void fota_reboot_work_fn(struct k_work *work)
+{
+	if (cloud_send_buffered_data() == -ENOBUFS) {
+		if (k_uptime_get() < fota_reboot_deadline) {
+			k_delayed_work_cancel(&cloud_send_buffered_data_work);
+			k_delayed_work_submit(&fota_reboot_work,
+					      MSG_BUF_RETRY_DELAY);
+			return;
+		}
+
+		LOG_WRN("Rebooting with buffered GPS entries not sent");
+	}
+
+	cfg_store_flush();
+	cloud_disconnect(cloud_backend);
+	sys_reboot(0);
 }
 
 static void work_init(void)
@@ -503,8 +875,55 @@ static void work_init(void)
 			    set_led_device_mode_work_fn);
 	k_delayed_work_init(&movement_timeout_work,
 			    movement_timeout_work_fn);
+	k_delayed_work_init(&fota_reboot_work, fota_reboot_work_fn);
+#if defined(CONFIG_GEOFENCE)
+	k_delayed_work_init(&cloud_send_geofence_event_work,
+			    cloud_send_geofence_event_work_fn);
+#endif
+#if defined(CONFIG_METRICS)
+	k_delayed_work_init(&cloud_send_metrics_work,
+			    cloud_send_metrics_work_fn);
+#endif
+}
+
+static void motion_handler(const struct event_bus_evt *evt)
+{
+	struct acc_sample sample = {
+		.timestamp = evt->motion.ts,
+	};
+
+	memcpy(sample.acc, evt->motion.acc, sizeof(sample.acc));
+	snapshot_publish(&acc_snapshot, &sample);
+
+	k_sem_give(&accel_trig_sem);
+}
+
+EVENT_BUS_SUBSCRIBE(main_motion, EVENT_BUS_MOTION, motion_handler);
+
+static void cfg_updated_handler(const struct event_bus_evt *evt)
+{
+	static u32_t version;
+
+	/* Already applied versions are also published, to confirm that the
+	 * stored configuration is current.
+	 */
+	if (evt->cfg.version != 0 && evt->cfg.version == version) {
+		return;
+	}
+
+	version = evt->cfg.version;
+
+	if (cloud_connected && cloud_data.movement_timeout != movement_timeout) {
+		movement_timeout_schedule();
+	}
+
+	cfg_changed_cycles = evt->cycles;
+	k_sem_give(&cfg_changed_sem);
 }
 
+EVENT_BUS_SUBSCRIBE(main_cfg_updated, EVENT_BUS_CFG_UPDATED,
+		    cfg_updated_handler);
+
 static void adxl362_trigger_handler(struct device *dev,
 				    struct sensor_trigger *trig)
 {
@@ -529,11 +948,17 @@ static void adxl362_trigger_handler(struct device *dev,
 		if ((abs(x) > get_accel_thres()) ||
 		    (abs(y) > get_accel_thres()) ||
 		    (abs(z) > get_accel_thres())) {
-			cloud_data.acc[0] = x;
-			cloud_data.acc[1] = y;
-			cloud_data.acc[2] = z;
-			cloud_data.acc_timestamp = k_uptime_get();
-			k_sem_give(&accel_trig_sem);
+			struct event_bus_evt evt = {
+				.type = EVENT_BUS_MOTION,
+				.motion = {
+					.acc = { x, y, z },
+					.ts = k_uptime_get(),
+				},
+			};
+
+			if (event_bus_publish(&evt)) {
+				LOG_WRN("Motion event dropped");
+			}
 		}
 
 		break;
@@ -542,24 +967,43 @@ static void adxl362_trigger_handler(struct device *dev,
 	}
 }
 
+static void gps_fix_handler(const struct event_bus_evt *evt)
+{
+	boot_seq_mark(BOOT_PHASE_FIRST_FIX);
+
+#if defined(CONFIG_GEOFENCE)
+	geofence_evaluate(evt->gps_fix.latitude, evt->gps_fix.longitude);
+#endif
+}
+
+EVENT_BUS_SUBSCRIBE(main_gps_fix, EVENT_BUS_GPS_FIX, gps_fix_handler);
+
 static void gps_trigger_handler(struct device *dev, struct gps_trigger *trigger)
 {
-	static u32_t fix_count;
+	static struct event_bus_evt evt = { .type = EVENT_BUS_GPS_FIX };
 	struct gps_data gps_data;
 
 	ARG_UNUSED(trigger);
 
-	if (++fix_count < CONFIG_GPS_CONTROL_FIX_COUNT) {
+	LOG_INF("gps control handler triggered!");
+
+	gps_channel_get(dev, GPS_CHAN_PVT, &gps_data);
+	set_current_time(&gps_data.pvt);
+
+	/* Outliers are not allowed to end the search. */
+	if (fix_selection_add(&gps_data.pvt) == -EINVAL) {
 		return;
 	}
 
-	fix_count = 0;
+	evt.gps_fix = gps_data.pvt;
+	if (event_bus_publish(&evt)) {
+		LOG_WRN("GPS fix event dropped");
+	}
 
-	LOG_INF("gps control handler triggered!");
+	if (gps_control_on_trigger(&gps_data.pvt)) {
+		return;
+	}
 
-	gps_channel_get(dev, GPS_CHAN_PVT, &gps_data);
-	set_current_time(gps_data);
-	populate_gps_buffer(gps_data);
 	k_sem_give(&gps_timeout_sem);
 }
 
@@ -593,10 +1037,11 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	switch (evt->type) {
 	case CLOUD_EVT_CONNECTED:
 		LOG_INF("CLOUD_EVT_CONNECTED");
+		ui_led_clear_error();
+		boot_seq_mark(BOOT_PHASE_CLOUD_CONNECTED);
 		cloud_synchronize();
 		boot_write_img_confirmed();
-		k_delayed_work_submit(&movement_timeout_work,
-				      K_SECONDS(cloud_data.movement_timeout));
+		movement_timeout_schedule();
 		cloud_connected = true;
 		break;
 	case CLOUD_EVT_READY:
@@ -608,11 +1053,13 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 		break;
 	case CLOUD_EVT_ERROR:
 		LOG_ERR("CLOUD_EVT_ERROR");
+		ui_led_set_pattern(UI_LED_ERROR_CLOUD);
 		break;
 	case CLOUD_EVT_FOTA_DONE:
 		LOG_INF("CLOUD_EVT_FOTA_DONE");
-		cloud_disconnect(cloud_backend);
-		sys_reboot(0);
+		metrics_reboot_reason_set(METRICS_REBOOT_FOTA);
+		fota_reboot_deadline = k_uptime_get() + FOTA_REBOOT_TIMEOUT;
+		k_delayed_work_submit(&fota_reboot_work, K_NO_WAIT);
 		break;
 	case CLOUD_EVT_DATA_SENT:
 		LOG_INF("CLOUD_EVT_DATA_SENT");
@@ -620,9 +1067,20 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	case CLOUD_EVT_DATA_RECEIVED:
 		LOG_INF("CLOUD_EVT_DATA_RECEIVED");
 		err = cloud_decode_response(evt->data.msg.buf, &cloud_data);
-		if (err) {
+		/* An already applied configuration still confirms that the
+		 * stored one is current.
+		 */
+		if (err && err != -EALREADY) {
 			LOG_ERR("Could not decode response %d", err);
+			break;
 		}
+
+		struct event_bus_evt cfg_evt = {
+			.type = EVENT_BUS_CFG_UPDATED,
+			.cfg.version = cloud_data.cfg_version,
+		};
+
+		event_bus_publish(&cfg_evt);
 		break;
 	case CLOUD_EVT_PAIR_REQUEST:
 		LOG_INF("CLOUD_EVT_PAIR_REQUEST");
@@ -636,20 +1094,77 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	}
 }
 
+/* The jitter of reconnect delays is seeded from the client ID, so that
+ * devices that boot or lose the link at the same time do not reconnect
+ * in step.
+ */
+static u32_t backoff_seed;
+
+static void backoff_seed_init(void)
+{
+	/* FNV-1a */
+	u32_t hash = 2166136261;
+
+	for (const char *c = client_id_buf; *c; c++) {
+		hash = (hash ^ *c) * 16777619;
+	}
+
+	backoff_seed = (hash ^ k_cycle_get_32()) | 1;
+}
+
+/* Returns between half and all of the backoff, in milliseconds. */
+static s32_t backoff_delay_get(u32_t backoff)
+{
+	u32_t half = K_SECONDS(backoff) / 2;
+
+	/* xorshift32 */
+	backoff_seed ^= backoff_seed << 13;
+	backoff_seed ^= backoff_seed >> 17;
+	backoff_seed ^= backoff_seed << 5;
+
+	return half + backoff_seed % (half + 1);
+}
+
 void cloud_poll(void)
 {
+	s64_t connect_start = 0;
+	u32_t backoff = 0;
 	int err;
 
 connect:
 
-	k_sem_take(&cloud_conn_sem, K_FOREVER);
+	link_monitor_wait_registered(K_FOREVER);
+
+	/* Delayed after registration, so that devices that regain coverage
+	 * at the same time do not reconnect in step.
+	 */
+	if (backoff) {
+		s32_t delay = backoff_delay_get(backoff);
+
+		LOG_INF("Reconnecting in %d ms", delay);
+		k_sleep(delay);
+	}
+
+	if (connect_start == 0) {
+		connect_start = k_uptime_get();
+	}
 
 	err = cloud_connect(cloud_backend);
 	if (err) {
 		LOG_ERR("cloud_connect failed: %d", err);
+		metrics_counter_inc(METRICS_CLOUD_ERRORS);
+		backoff = backoff ?
+			  MIN(backoff * 2, CONFIG_CLOUD_RECONNECT_BACKOFF_MAX) :
+			  CONFIG_CLOUD_RECONNECT_BACKOFF_MIN;
 		goto connect;
 	}
 
+	metrics_counter_inc(METRICS_CLOUD_CONNECTS);
+	metrics_histogram_add(METRICS_CONNECT_TIME,
+			      (k_uptime_get() - connect_start) / 1000);
+	connect_start = 0;
+	backoff = 0;
+
 	struct pollfd fds[] = { { .fd = cloud_backend->config->socket,
 				  .events = POLLIN } };
 
@@ -659,6 +1174,7 @@ connect:
 
 		if (err < 0) {
 			LOG_ERR("poll, error: %d", err);
+			metrics_counter_inc(METRICS_CLOUD_ERRORS);
 			error_handler(err);
 			continue;
 		}
@@ -669,7 +1185,9 @@ connect:
 		}
 
 		if ((fds[0].revents & POLLIN) == POLLIN) {
+			APP_TRACE_BEGIN(APP_TRACE_CLOUD_INPUT);
 			cloud_input(cloud_backend);
+			APP_TRACE_END(APP_TRACE_CLOUD_INPUT);
 		}
 
 		if ((fds[0].revents & POLLNVAL) == POLLNVAL) {
@@ -694,12 +1212,44 @@ connect:
 	}
 
 	cloud_disconnect(cloud_backend);
+	backoff = CONFIG_CLOUD_RECONNECT_BACKOFF_MIN;
 	goto connect;
 }
 
 K_THREAD_DEFINE(cloud_poll_thread, CONFIG_CLOUD_POLL_STACKSIZE, cloud_poll,
 		NULL, NULL, NULL, CONFIG_CLOUD_POLL_PRIORITY, 0, K_NO_WAIT);
 
+/* Called from the AT notification context. */
+static void link_monitor_handler(enum link_monitor_evt_type type,
+				 const struct link_monitor_state *state)
+{
+	switch (type) {
+	case LINK_MONITOR_EVT_REGISTERED:
+		boot_seq_mark(BOOT_PHASE_LTE_REGISTERED);
+
+		if (!cloud_connected) {
+			ui_led_set_pattern(UI_CLOUD_CONNECTING);
+			break;
+		}
+
+		/* Flush what was buffered while the link was down. */
+		k_delayed_work_submit(&cloud_send_buffered_data_work,
+				      K_NO_WAIT);
+		k_delayed_work_submit(&set_led_device_mode_work, K_NO_WAIT);
+		break;
+	case LINK_MONITOR_EVT_DEREGISTERED:
+		ui_led_set_pattern(UI_LTE_CONNECTING);
+		break;
+	case LINK_MONITOR_EVT_RRC_CHANGED:
+		if (state->registered && !state->rrc_connected) {
+			boot_seq_mark(BOOT_PHASE_LTE_IDLE);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 static void modem_rsrp_handler(char rsrp_value)
 {
 	if (rsrp_value == 255) {
@@ -707,6 +1257,7 @@ static void modem_rsrp_handler(char rsrp_value)
 	}
 
 	rsrp = rsrp_value;
+	metrics_gauge_set(METRICS_RSRP, rsrp);
 
 	LOG_INF("Incoming RSRP status message, RSRP value is %d", rsrp);
 }
@@ -721,9 +1272,9 @@ static int modem_data_init(void)
 		return err;
 	}
 
-	err = modem_info_params_init(&modem_param);
+	err = modem_cache_init(&modem_param);
 	if (err) {
-		LOG_INF("modem_info_params_init, error: %d", err);
+		LOG_INF("modem_cache_init, error: %d", err);
 		return err;
 	}
 
@@ -740,24 +1291,27 @@ static int populate_app_endpoint_topics()
 {
 	int err;
 
+	/* The client ID can be shorter than the IMEI the topic buffers are
+	 * sized for.
+	 */
 	err = snprintf(batch_topic, sizeof(batch_topic), BATCH_TOPIC,
 		       client_id_buf);
-	if (err != BATCH_TOPIC_LEN) {
+	if (err < 0 || err >= sizeof(batch_topic)) {
 		return -ENOMEM;
 	}
 
 	pub_ep_topics_sub[0].str = batch_topic;
-	pub_ep_topics_sub[0].len = BATCH_TOPIC_LEN;
+	pub_ep_topics_sub[0].len = err;
 	pub_ep_topics_sub[0].type = CLOUD_EP_TOPIC_BATCH;
 
 	err = snprintf(cfg_topic, sizeof(cfg_topic), CFG_TOPIC,
 		       client_id_buf);
-	if (err != CFG_TOPIC_LEN) {
+	if (err < 0 || err >= sizeof(cfg_topic)) {
 		return -ENOMEM;
 	}
 
 	sub_ep_topics_sub[0].str = cfg_topic;
-	sub_ep_topics_sub[0].len = CFG_TOPIC_LEN;
+	sub_ep_topics_sub[0].len = err;
 	sub_ep_topics_sub[0].type = CLOUD_EP_TOPIC_CONFIG;
 
 	err = cloud_ep_subscriptions_add(cloud_backend,
@@ -779,17 +1333,22 @@ static int cloud_setup(void)
 	__ASSERT(cloud_backend != NULL, "%s cloud backend not found",
 		 CONFIG_CLOUD_BACKEND);
 
-	err = modem_info_string_get(MODEM_INFO_IMEI, client_id_buf);
-	if (err != AWS_CLOUD_CLIENT_ID_LEN) {
-		LOG_ERR("modem_info_string_get, error: %d", err);
-		return err;
+	if (sizeof(CONFIG_CLOUD_CLIENT_ID) > 1) {
+		strcpy(client_id_buf, CONFIG_CLOUD_CLIENT_ID);
+	} else {
+		err = modem_info_string_get(MODEM_INFO_IMEI, client_id_buf);
+		if (err != AWS_CLOUD_CLIENT_ID_LEN) {
+			LOG_ERR("modem_info_string_get, error: %d", err);
+			return err;
+		}
 	}
 
-	LOG_INF("Device IMEI: %s", log_strdup(client_id_buf));
+	LOG_INF("Client ID: %s", log_strdup(client_id_buf));
+	backoff_seed_init();
 
 	/* Fetch IMEI from modem data and set IMEI as cloud connection ID **/
 	cloud_backend->config->id = client_id_buf;
-	cloud_backend->config->id_len = sizeof(client_id_buf);
+	cloud_backend->config->id_len = strlen(client_id_buf);
 
 	err = cloud_init(cloud_backend, cloud_event_handler);
 	if (err) {
@@ -807,16 +1366,97 @@ static int cloud_setup(void)
 	return err;
 }
 
+/* Waits until the next GPS search is due: when the sleep interval has
+ * passed in active mode, on motion after it in passive mode, or on a fix
+ * request. The interval and mode are re-read on every configuration
+ * change, so that new values apply during the wait. Without the interval,
+ * as before the first search, only passive mode waits, for motion.
+ */
+static void wait_for_search(bool interval)
+{
+	s64_t sleep_start = k_uptime_get();
+
+	if (interval) {
+		LOG_INF("Going to sleep for: %d seconds", check_active_wait());
+	}
+
+	while (true) {
+		s64_t remaining = interval ?
+				  K_SECONDS(check_active_wait()) -
+				  (k_uptime_get() - sleep_start) : 0;
+		int err;
+
+		if (remaining <= 0 && cloud_data.active) {
+			return;
+		}
+
+		err = k_poll(wake_events,
+			     remaining > 0 ? WAKE_MOTION : WAKE_EVENT_COUNT,
+			     remaining > 0 ? (s32_t)remaining : K_FOREVER);
+		if (err == -EAGAIN) {
+			continue;
+		}
+
+		for (size_t i = 0; i < WAKE_EVENT_COUNT; i++) {
+			wake_events[i].state = K_POLL_STATE_NOT_READY;
+		}
+
+		if (!k_sem_take(&fix_request_sem, K_NO_WAIT)) {
+			LOG_INF("GPS fix requested");
+			return;
+		}
+
+		if (!k_sem_take(&cfg_changed_sem, K_NO_WAIT)) {
+			LOG_INF("Configuration applied after %d us",
+				(u32_t)(SYS_CLOCK_HW_CYCLES_TO_NS64(
+					k_cycle_get_32() - cfg_changed_cycles) /
+					NSEC_PER_USEC));
+			continue;
+		}
+
+		if (remaining <= 0 && !k_sem_take(&accel_trig_sem, K_NO_WAIT)) {
+			LOG_INF("The cat is moving!");
+			return;
+		}
+	}
+}
+
 void main(void)
 {
 	int err;
+	static struct gps_pvt gps_pvt;
 
 	LOG_INF("The cat tracker has started");
 	LOG_INF("Version: %s", log_strdup(CONFIG_CAT_TRACKER_APP_VERSION));
 
+	boot_seq_init();
+	log_bench_run();
 	work_init();
+
+	/* Apply the last known configuration before the first GPS search,
+	 * the defaults are kept if it cannot be read.
+	 */
+	err = cfg_store_init(&cloud_data);
+	if (err) {
+		LOG_ERR("cfg_store_init, error: %d", err);
+	}
+
 	adxl362_init();
 
+	metrics_init();
+	mem_track_init();
+	stack_monitor_init();
+
+	err = cloud_codec_init();
+	if (err) {
+		LOG_INF("cloud_codec_init, error: %d", err);
+		error_handler(err);
+	}
+
+#if defined(CONFIG_GEOFENCE)
+	geofence_init(geofence_event_handler);
+#endif
+
 	err = modem_data_init();
 	if (err) {
 		LOG_INF("modem_data_init, error: %d", err);
@@ -841,43 +1481,81 @@ void main(void)
 		error_handler(err);
 	}
 
-	err = lte_connect(LTE_INIT);
+	err = lte_init();
+	if (err) {
+		LOG_INF("lte_init, error: %d", err);
+		error_handler(err);
+	}
+
+	err = link_monitor_init(link_monitor_handler);
 	if (err) {
-		LOG_INF("lte_connect, error: %d", err);
+		LOG_INF("link_monitor_init, error: %d", err);
 		error_handler(err);
 	}
 
+	/* Already attached if the modem was connected at system init. */
+	if (link_monitor_is_registered()) {
+		boot_seq_mark(BOOT_PHASE_LTE_REGISTERED);
+		boot_seq_mark(BOOT_PHASE_LTE_IDLE);
+	}
+
+	k_thread_start(lte_attach_thread);
+
 	nrf9160_time_init();
 
-	/*Sleep so that the device manages to adapt
-	  to its new configuration before a GPS search*/
-	k_sleep(K_SECONDS(20));
+	boot_seq_mark(BOOT_PHASE_INIT);
 
-	while (true) {
-		/*Check current device mode*/
-		if (!cloud_data.active) {
-			if (!k_sem_take(&accel_trig_sem, K_FOREVER)) {
-				LOG_INF("The cat is moving!");
-			}
-		}
+	/* GPS only gets time from the modem when LTE is not searching and
+	 * has no RRC connection. Start the first search when the link is
+	 * idle, without waiting for coverage indefinitely.
+	 */
+	if (boot_seq_wait(BOOT_PHASE_LTE_IDLE,
+			  K_SECONDS(CONFIG_BOOT_SEQ_GPS_START_TIMEOUT))) {
+		LOG_WRN("LTE link not idle, starting GPS search anyway");
+	}
+
+	/* A passive device does not search on boot until it moves. */
+	wait_for_search(false);
 
+	while (true) {
 		/*Start GPS search*/
-		gps_control_start(K_NO_WAIT);
+		fix_selection_reset();
+
+		APP_TRACE_BEGIN(APP_TRACE_GPS_SEARCH);
+		boot_seq_mark(BOOT_PHASE_GPS_START);
 
-		/*Wait for GPS search timeout*/
-		k_sem_take(&gps_timeout_sem, K_SECONDS(cloud_data.gps_timeout));
+		if (!gps_control_start(K_NO_WAIT)) {
+			/*Wait for GPS search timeout*/
+			k_sem_take(&gps_timeout_sem,
+				   K_SECONDS(MIN(cloud_data.gps_timeout,
+					     CONFIG_GPS_CONTROL_FIX_TRY_TIME)));
 
-		/*Stop GPS search*/
-		gps_control_stop(K_NO_WAIT);
+			/*Stop GPS search*/
+			gps_control_stop(K_NO_WAIT);
+		}
+
+		APP_TRACE_END(APP_TRACE_GPS_SEARCH);
 
-		/*Check lte connection*/
-		lte_connect(CHECK_LTE_CONNECTION);
+		/*Store the best fix of the search*/
+		if (!fix_selection_get(&gps_pvt)) {
+			populate_gps_buffer(&gps_pvt);
+		}
 
 		/*Send update to cloud if a connection has been established*/
 		cloud_update();
 
 		/*Sleep*/
-		LOG_INF("Going to sleep for: %d seconds", check_active_wait());
-		k_sleep(K_SECONDS(check_active_wait()));
+		wait_for_search(true);
 	}
 }
+
+#if defined(CONFIG_SHELL)
+static int cmd_fix(const struct shell *shell, size_t argc, char **argv)
+{
+	k_sem_give(&fix_request_sem);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(fix, NULL, "Start a GPS search now", cmd_fix);
+#endif /* CONFIG_SHELL */
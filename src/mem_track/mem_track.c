@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#if defined(CONFIG_NEWLIB_LIBC)
+#include <malloc.h>
+#endif
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "mem_track.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(mem_track, CONFIG_MEM_TRACK_LOG_LEVEL);
+
+/* Prepended to every allocation, so that the size and the site are known
+ * when the memory is freed. The size keeps the user pointer 8-byte
+ * aligned.
+ */
+struct mem_track_hdr {
+	u32_t size;
+	u32_t site;
+};
+
+BUILD_ASSERT_MSG(sizeof(struct mem_track_hdr) == 8,
+		 "Allocation header breaks alignment");
+
+static struct mem_track_stats sites[MEM_TRACK_SITE_COUNT] = {
+	[MEM_TRACK_SITE_CODEC_DECODE] = { .name = "codec decode" },
+	[MEM_TRACK_SITE_CODEC_TREE] = { .name = "codec tree" },
+};
+
+static size_t total_current;
+static size_t total_peak;
+
+static struct k_spinlock lock;
+static struct k_delayed_work report_work;
+
+void *mem_track_malloc(enum mem_track_site site, size_t size)
+{
+	struct mem_track_hdr *hdr;
+	struct mem_track_stats *stats;
+	k_spinlock_key_t key;
+
+	__ASSERT_NO_MSG(site < MEM_TRACK_SITE_COUNT);
+
+	hdr = malloc(sizeof(*hdr) + size);
+	stats = &sites[site];
+
+	key = k_spin_lock(&lock);
+
+	if (hdr == NULL) {
+		stats->failures++;
+		k_spin_unlock(&lock, key);
+
+		LOG_WRN("Allocation of %d bytes failed, site: %s", size,
+			stats->name);
+
+		return NULL;
+	}
+
+	stats->allocs++;
+	stats->current += size;
+	stats->peak = MAX(stats->peak, stats->current);
+	stats->largest = MAX(stats->largest, size);
+
+	total_current += size;
+	total_peak = MAX(total_peak, total_current);
+
+	k_spin_unlock(&lock, key);
+
+	hdr->size = size;
+	hdr->site = site;
+
+	return hdr + 1;
+}
+
+void mem_track_free(void *ptr)
+{
+	struct mem_track_hdr *hdr;
+	k_spinlock_key_t key;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	hdr = (struct mem_track_hdr *)ptr - 1;
+
+	__ASSERT_NO_MSG(hdr->site < MEM_TRACK_SITE_COUNT);
+
+	key = k_spin_lock(&lock);
+	sites[hdr->site].current -= hdr->size;
+	total_current -= hdr->size;
+	k_spin_unlock(&lock, key);
+
+	free(hdr);
+}
+
+int mem_track_stats_get(enum mem_track_site site,
+			struct mem_track_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	if (site >= MEM_TRACK_SITE_COUNT) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&lock);
+	*stats = sites[site];
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+
+int mem_track_heap_info_get(struct mem_track_heap_info *info)
+{
+#if defined(CONFIG_NEWLIB_LIBC)
+	struct mallinfo mi = mallinfo();
+
+	info->arena = mi.arena;
+	info->used = mi.uordblks;
+	info->free = mi.fordblks;
+	info->free_chunks = mi.ordblks;
+
+	/* Free memory below the top chunk is split into holes between live
+	 * allocations, and might not fit a large allocation.
+	 */
+	info->fragmentation = mi.fordblks ?
+			      100 - (mi.keepcost * 100) / mi.fordblks : 0;
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void mem_track_report(void)
+{
+	struct mem_track_heap_info info;
+	struct mem_track_stats stats;
+
+	for (size_t i = 0; i < MEM_TRACK_SITE_COUNT; i++) {
+		mem_track_stats_get(i, &stats);
+
+		LOG_INF("%s: current %d, peak %d, largest %d, allocs %d, "
+			"failures %d", log_strdup(stats.name), stats.current,
+			stats.peak, stats.largest, stats.allocs,
+			stats.failures);
+	}
+
+	LOG_INF("Tracked total: current %d, peak %d", total_current,
+		total_peak);
+
+	if (!mem_track_heap_info_get(&info)) {
+		LOG_INF("Heap: arena %d, used %d, free %d in %d chunks, "
+			"fragmentation %d%%", info.arena, info.used, info.free,
+			info.free_chunks, info.fragmentation);
+	}
+}
+
+static void report_work_fn(struct k_work *work)
+{
+	mem_track_report();
+
+	k_delayed_work_submit(&report_work,
+			      K_SECONDS(CONFIG_MEM_TRACK_REPORT_INTERVAL));
+}
+
+void mem_track_init(void)
+{
+	k_delayed_work_init(&report_work, report_work_fn);
+
+	if (CONFIG_MEM_TRACK_REPORT_INTERVAL > 0) {
+		k_delayed_work_submit(&report_work,
+			K_SECONDS(CONFIG_MEM_TRACK_REPORT_INTERVAL));
+	}
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_mem_track(const struct shell *shell, size_t argc, char **argv)
+{
+	struct mem_track_heap_info info;
+	struct mem_track_stats stats;
+
+	shell_print(shell, "%-14s %8s %8s %8s %8s %8s", "site", "current",
+		    "peak", "largest", "allocs", "failures");
+
+	for (size_t i = 0; i < MEM_TRACK_SITE_COUNT; i++) {
+		mem_track_stats_get(i, &stats);
+
+		shell_print(shell, "%-14s %8u %8u %8u %8u %8u", stats.name,
+			    stats.current, stats.peak, stats.largest,
+			    stats.allocs, stats.failures);
+	}
+
+	shell_print(shell, "total current %u, peak %u", total_current,
+		    total_peak);
+
+	if (!mem_track_heap_info_get(&info)) {
+		shell_print(shell, "heap arena %u, used %u, free %u in %u "
+			    "chunks, fragmentation %d%%", info.arena,
+			    info.used, info.free, info.free_chunks,
+			    info.fragmentation);
+	}
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(mem_track, NULL, "Show heap allocation statistics",
+		   cmd_mem_track);
+#endif /* CONFIG_SHELL */
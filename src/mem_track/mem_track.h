@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef MEM_TRACK_H__
+#define MEM_TRACK_H__
+
+#include <zephyr.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Allocation sites that are tracked separately. */
+enum mem_track_site {
+	MEM_TRACK_SITE_CODEC_DECODE,
+	MEM_TRACK_SITE_CODEC_TREE,
+
+	MEM_TRACK_SITE_COUNT
+};
+
+struct mem_track_stats {
+	const char *name;
+	u32_t allocs;
+	u32_t failures;
+	/** Bytes currently allocated, excluding tracking overhead. */
+	size_t current;
+	size_t peak;
+	/** Largest single allocation. */
+	size_t largest;
+};
+
+struct mem_track_heap_info {
+	/** Bytes obtained from the system by the allocator. */
+	size_t arena;
+	size_t used;
+	size_t free;
+	/** Number of free chunks. */
+	size_t free_chunks;
+	/** Share of the free memory that is not in the top chunk, in
+	 *  percent.
+	 */
+	int fragmentation;
+};
+
+#if defined(CONFIG_MEM_TRACK)
+/**
+ * @brief Allocates memory and accounts it to an allocation site.
+ *
+ * @param site Allocation site.
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL on failure.
+ */
+void *mem_track_malloc(enum mem_track_site site, size_t size);
+
+/**
+ * @brief Frees memory allocated with mem_track_malloc().
+ *
+ * @param ptr Pointer to the memory, may be NULL.
+ */
+void mem_track_free(void *ptr);
+
+/**
+ * @brief Gets the statistics of an allocation site.
+ *
+ * @return 0 on success, -EINVAL if the site is invalid.
+ */
+int mem_track_stats_get(enum mem_track_site site,
+			struct mem_track_stats *stats);
+
+/**
+ * @brief Gets the state of the heap.
+ *
+ * @return 0 on success, -ENOTSUP if not available with the C library
+ *	   in use.
+ */
+int mem_track_heap_info_get(struct mem_track_heap_info *info);
+
+/**
+ * @brief Logs the statistics of all allocation sites.
+ */
+void mem_track_report(void);
+
+/**
+ * @brief Starts the periodic allocation report.
+ */
+void mem_track_init(void);
+#else
+static inline void *mem_track_malloc(enum mem_track_site site, size_t size)
+{
+	ARG_UNUSED(site);
+
+	return malloc(size);
+}
+
+static inline void mem_track_free(void *ptr)
+{
+	free(ptr);
+}
+
+static inline void mem_track_init(void)
+{
+}
+#endif /* CONFIG_MEM_TRACK */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* MEM_TRACK_H__ */
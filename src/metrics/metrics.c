@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <linker/section_tags.h>
+
+#include "metrics.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(metrics, CONFIG_METRICS_LOG_LEVEL);
+
+#define REBOOT_INFO_MAGIC 0x4d455452
+
+/* Kept in RAM that is not cleared at boot, so that the reason recorded
+ * before a reboot can be reported after it.
+ */
+struct reboot_info {
+	u32_t magic;
+	s32_t reason;
+	u32_t count;
+};
+
+static __noinit struct reboot_info reboot_info;
+
+static const char * const counter_names[] = {
+	[METRICS_PUBLISH_OK] = "pub",
+	[METRICS_PUBLISH_FAILED] = "pubErr",
+	[METRICS_ENCODE_FAILED] = "encErr",
+	[METRICS_CLOUD_CONNECTS] = "conn",
+	[METRICS_CLOUD_ERRORS] = "connErr",
+	[METRICS_GPS_FIXES] = "fix",
+	[METRICS_GPS_DROPPED] = "drop",
+	[METRICS_AT_COMMANDS] = "at",
+	[METRICS_PUBLISH_BYTES] = "pubB",
+	[METRICS_CFG_PARSES_AVOIDED] = "cfgDup",
+	[METRICS_CFG_REPORTS_AVOIDED] = "cfgSame",
+	[METRICS_LED_WAKEUPS] = "ledWk",
+};
+
+static const char * const gauge_names[] = {
+	[METRICS_RSRP] = "rsrp",
+	[METRICS_HEAP_USED] = "heap",
+	[METRICS_TIME_SOURCE] = "tsrc",
+	[METRICS_BOOT_FIRST_FIX] = "bfix",
+	[METRICS_BOOT_FIRST_PUBLISH] = "bpub",
+};
+
+static const char * const histogram_names[] = {
+	[METRICS_TTFF] = "ttff",
+	[METRICS_PUBLISH_LATENCY] = "lat",
+	[METRICS_CONNECT_TIME] = "connT",
+};
+
+/* Upper bounds of the histogram buckets, the last bucket takes the
+ * rest.
+ */
+static const u32_t histogram_bounds[][METRICS_HISTOGRAM_BUCKETS - 1] = {
+	[METRICS_TTFF] = { 5, 15, 30, 60, 120 },
+	[METRICS_PUBLISH_LATENCY] = { 100, 250, 500, 1000, 3000 },
+	[METRICS_CONNECT_TIME] = { 5, 15, 60, 300, 900 },
+};
+
+BUILD_ASSERT_MSG(ARRAY_SIZE(counter_names) == METRICS_COUNTER_COUNT,
+		 "Missing counter name");
+BUILD_ASSERT_MSG(ARRAY_SIZE(gauge_names) == METRICS_GAUGE_COUNT,
+		 "Missing gauge name");
+BUILD_ASSERT_MSG(ARRAY_SIZE(histogram_names) == METRICS_HISTOGRAM_COUNT,
+		 "Missing histogram name");
+BUILD_ASSERT_MSG(ARRAY_SIZE(histogram_bounds) == METRICS_HISTOGRAM_COUNT,
+		 "Missing histogram bounds");
+
+static struct metrics_snapshot current;
+static s64_t last_report;
+static bool reported_once;
+
+static struct k_spinlock lock;
+
+void metrics_counter_inc(enum metrics_counter counter)
+{
+	metrics_counter_add(counter, 1);
+}
+
+void metrics_counter_add(enum metrics_counter counter, u32_t value)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	current.counters[counter] += value;
+
+	k_spin_unlock(&lock, key);
+}
+
+void metrics_gauge_set(enum metrics_gauge gauge, s32_t value)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	current.gauges[gauge] = value;
+
+	k_spin_unlock(&lock, key);
+}
+
+void metrics_histogram_add(enum metrics_histogram histogram, u32_t value)
+{
+	const u32_t *bounds = histogram_bounds[histogram];
+	k_spinlock_key_t key;
+	size_t i;
+
+	for (i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+		if (value <= bounds[i]) {
+			break;
+		}
+	}
+
+	key = k_spin_lock(&lock);
+
+	if (current.histograms[histogram][i] < UINT16_MAX) {
+		current.histograms[histogram][i]++;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void metrics_reboot_reason_set(s32_t reason)
+{
+	if (reboot_info.reason == 0) {
+		reboot_info.reason = reason;
+	}
+}
+
+bool metrics_publish_due(void)
+{
+	/* The first report after boot carries the reboot reason. */
+	return !reported_once || k_uptime_get() - last_report >=
+				 K_SECONDS(CONFIG_METRICS_PUBLISH_INTERVAL);
+}
+
+void metrics_snapshot_get(struct metrics_snapshot *snapshot)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*snapshot = current;
+
+	k_spin_unlock(&lock, key);
+
+	snapshot->uptime = k_uptime_get() / MSEC_PER_SEC;
+}
+
+void metrics_reported(const struct metrics_snapshot *snapshot)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+		current.counters[i] -= snapshot->counters[i];
+	}
+
+	for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+		for (size_t j = 0; j < METRICS_HISTOGRAM_BUCKETS; j++) {
+			current.histograms[i][j] -= snapshot->histograms[i][j];
+		}
+	}
+
+	last_report = k_uptime_get();
+	reported_once = true;
+
+	k_spin_unlock(&lock, key);
+}
+
+const char *metrics_counter_name(enum metrics_counter counter)
+{
+	return counter_names[counter];
+}
+
+const char *metrics_gauge_name(enum metrics_gauge gauge)
+{
+	return gauge_names[gauge];
+}
+
+const char *metrics_histogram_name(enum metrics_histogram histogram)
+{
+	return histogram_names[histogram];
+}
+
+void metrics_init(void)
+{
+	if (reboot_info.magic != REBOOT_INFO_MAGIC) {
+		reboot_info.magic = REBOOT_INFO_MAGIC;
+		reboot_info.reason = 0;
+		reboot_info.count = 0;
+	} else {
+		reboot_info.count++;
+	}
+
+	current.reboot_reason = reboot_info.reason;
+	current.reboot_count = reboot_info.count;
+
+	LOG_INF("Reboot %d since power on, reason: %d", reboot_info.count,
+		reboot_info.reason);
+
+	/* A reset without a recorded reason is reported as unknown. */
+	reboot_info.reason = 0;
+}
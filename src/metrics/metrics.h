@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef METRICS_H__
+#define METRICS_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_HISTOGRAM_BUCKETS 6
+
+/** Counters, reset when a report has been sent. */
+enum metrics_counter {
+	METRICS_PUBLISH_OK,
+	METRICS_PUBLISH_FAILED,
+	METRICS_ENCODE_FAILED,
+	METRICS_CLOUD_CONNECTS,
+	METRICS_CLOUD_ERRORS,
+	METRICS_GPS_FIXES,
+	METRICS_GPS_DROPPED,
+	METRICS_AT_COMMANDS,
+	METRICS_PUBLISH_BYTES,
+	/* Shadow messages dropped as already applied, before parsing. */
+	METRICS_CFG_PARSES_AVOIDED,
+	/* Shadow messages that changed no value, so no report was due. */
+	METRICS_CFG_REPORTS_AVOIDED,
+	/* Runs of the LED work item, each one a CPU wakeup. */
+	METRICS_LED_WAKEUPS,
+
+	METRICS_COUNTER_COUNT
+};
+
+/** Gauges, keep the last value set. */
+enum metrics_gauge {
+	METRICS_RSRP,
+	METRICS_HEAP_USED,
+	METRICS_TIME_SOURCE,
+	/* Uptime in milliseconds at the first fix and publish. */
+	METRICS_BOOT_FIRST_FIX,
+	METRICS_BOOT_FIRST_PUBLISH,
+
+	METRICS_GAUGE_COUNT
+};
+
+/** Histograms with fixed bucket bounds, reset with the counters. */
+enum metrics_histogram {
+	/** GPS time to first fix in seconds. */
+	METRICS_TTFF,
+	/** cloud_send() latency in milliseconds. */
+	METRICS_PUBLISH_LATENCY,
+	/* Seconds from the first connection attempt to connected. */
+	METRICS_CONNECT_TIME,
+
+	METRICS_HISTOGRAM_COUNT
+};
+
+/** Values of METRICS_TIME_SOURCE. */
+enum metrics_time_source {
+	METRICS_TIME_SOURCE_NONE,
+	METRICS_TIME_SOURCE_NETWORK,
+	METRICS_TIME_SOURCE_NTP,
+};
+
+/** Reboot reasons other than the error codes passed to error_handler(). */
+#define METRICS_REBOOT_FOTA		0x10000
+#define METRICS_REBOOT_FATAL_BASE	0x20000
+
+struct metrics_snapshot {
+	u32_t counters[METRICS_COUNTER_COUNT];
+	s32_t gauges[METRICS_GAUGE_COUNT];
+	u16_t histograms[METRICS_HISTOGRAM_COUNT][METRICS_HISTOGRAM_BUCKETS];
+	/** Reason of the previous reboot, 0 if unknown. */
+	s32_t reboot_reason;
+	u32_t reboot_count;
+	u32_t uptime;
+};
+
+#if defined(CONFIG_METRICS)
+void metrics_counter_inc(enum metrics_counter counter);
+void metrics_counter_add(enum metrics_counter counter, u32_t value);
+void metrics_gauge_set(enum metrics_gauge gauge, s32_t value);
+void metrics_histogram_add(enum metrics_histogram histogram, u32_t value);
+
+/**
+ * @brief Records the reason of an imminent reboot. It is reported after
+ *	  the reboot. Only the first reason recorded before a reboot is
+ *	  kept, as later errors are usually consequences of the first.
+ */
+void metrics_reboot_reason_set(s32_t reason);
+
+/**
+ * @brief Returns true if the publish interval has passed since the last
+ *	  report.
+ */
+bool metrics_publish_due(void);
+
+/**
+ * @brief Gets the current values.
+ */
+void metrics_snapshot_get(struct metrics_snapshot *snapshot);
+
+/**
+ * @brief Marks the values in the snapshot as reported. Counters and
+ *	  histograms are reduced by the reported values, so that events
+ *	  counted while the report was sent are kept.
+ */
+void metrics_reported(const struct metrics_snapshot *snapshot);
+
+const char *metrics_counter_name(enum metrics_counter counter);
+const char *metrics_gauge_name(enum metrics_gauge gauge);
+const char *metrics_histogram_name(enum metrics_histogram histogram);
+
+/**
+ * @brief Reads the reboot reason of the previous boot.
+ */
+void metrics_init(void);
+#else
+static inline void metrics_counter_inc(enum metrics_counter counter)
+{
+}
+
+static inline void metrics_counter_add(enum metrics_counter counter,
+				       u32_t value)
+{
+}
+
+static inline void metrics_gauge_set(enum metrics_gauge gauge, s32_t value)
+{
+}
+
+static inline void metrics_histogram_add(enum metrics_histogram histogram,
+					 u32_t value)
+{
+}
+
+static inline void metrics_reboot_reason_set(s32_t reason)
+{
+}
+
+static inline void metrics_init(void)
+{
+}
+#endif /* CONFIG_METRICS */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* METRICS_H__ */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "modem_cache.h"
+#include <link_monitor.h>
+#include <metrics.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(modem_cache, CONFIG_MODEM_CACHE_LOG_LEVEL);
+
+static struct modem_param_info *params;
+static bool device_params_read;
+static u32_t at_count;
+
+static int param_get(struct lte_param *param)
+{
+	int ret;
+
+	at_count++;
+	metrics_counter_inc(METRICS_AT_COMMANDS);
+
+	if (modem_info_type_get(param->type) == AT_PARAM_TYPE_STRING) {
+		ret = modem_info_string_get(param->type, param->value_string);
+	} else {
+		ret = modem_info_short_get(param->type, &param->value);
+	}
+
+	if (ret < 0) {
+		LOG_ERR("Could not get modem parameter %d, error: %d",
+			param->type, ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Notifications without a cell, such as on detach, leave the last
+ * reported cell to expire.
+ */
+static bool cell_from_notification(void)
+{
+	struct link_monitor_state link;
+
+	link_monitor_state_get(&link);
+
+	if (link.cell_ts == 0 || k_uptime_get() - link.cell_ts >
+				 K_SECONDS(CONFIG_MODEM_CACHE_CELL_MAX_AGE)) {
+		return false;
+	}
+
+	strcpy(params->network.area_code.value_string, link.tac);
+	strcpy(params->network.cellid_hex.value_string, link.cell_id);
+
+	return true;
+}
+
+static int network_params_get(void)
+{
+	struct network_param *network = &params->network;
+	int err;
+
+	err = param_get(&network->current_band);
+	err = err ? err : param_get(&network->current_operator);
+	err = err ? err : param_get(&network->ip_address);
+	err = err ? err : param_get(&network->lte_mode);
+	err = err ? err : param_get(&network->nbiot_mode);
+	err = err ? err : param_get(&network->gps_mode);
+
+	if (!err && !cell_from_notification()) {
+		err = param_get(&network->area_code);
+		err = err ? err : param_get(&network->cellid_hex);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	network->area_code.value = strtol(network->area_code.value_string,
+					  NULL, 16);
+	network->cellid_dec = strtol(network->cellid_hex.value_string,
+				     NULL, 16);
+
+	return 0;
+}
+
+static int device_params_get(void)
+{
+	int err;
+
+	err = param_get(&params->sim.iccid);
+	err = err ? err : param_get(&params->device.modem_fw);
+	err = err ? err : param_get(&params->device.imei);
+
+	if (err) {
+		return err;
+	}
+
+	params->device.board = CONFIG_BOARD;
+	device_params_read = true;
+
+	return 0;
+}
+
+int modem_cache_init(struct modem_param_info *modem_params)
+{
+	int err;
+
+	params = modem_params;
+
+	err = modem_info_params_init(params);
+	if (err) {
+		LOG_ERR("modem_info_params_init, error: %d", err);
+		return err;
+	}
+
+	return 0;
+}
+
+int modem_cache_update(u32_t groups)
+{
+	u32_t start = at_count;
+	int err = 0;
+
+	if (groups & MODEM_CACHE_BATTERY) {
+		err = param_get(&params->device.battery);
+	}
+
+	if (!err && (groups & MODEM_CACHE_NETWORK)) {
+		err = network_params_get();
+	}
+
+	if (!err && (groups & MODEM_CACHE_DEVICE) && !device_params_read) {
+		err = device_params_get();
+	}
+
+	LOG_DBG("%d AT commands for update 0x%x", at_count - start, groups);
+
+	return err;
+}
+
+u32_t modem_cache_at_count_get(void)
+{
+	return at_count;
+}
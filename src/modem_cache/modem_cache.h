@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef MODEM_CACHE_H__
+#define MODEM_CACHE_H__
+
+#include <zephyr.h>
+#include <modem_info.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Groups of modem parameters that can be updated. */
+#define MODEM_CACHE_BATTERY	BIT(0)
+/** Band, system mode, operator, cell and IP address. */
+#define MODEM_CACHE_NETWORK	BIT(1)
+/** ICCID, IMEI, modem firmware and board, read once per boot. */
+#define MODEM_CACHE_DEVICE	BIT(2)
+
+/**
+ * @brief Initializes the cache.
+ *
+ * @param params Parameters to update. Must be valid for the lifetime
+ *		 of the application.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int modem_cache_init(struct modem_param_info *params);
+
+/**
+ * @brief Updates a set of parameters from the modem.
+ *
+ * Device parameters are only read the first time they are requested.
+ * The tracking area and cell are taken from the link monitor when its
+ * last +CEREG notification is recent enough.
+ *
+ * @param groups Bitmask of MODEM_CACHE_* groups.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int modem_cache_update(u32_t groups);
+
+/**
+ * @brief Returns the number of AT commands sent by the cache since boot.
+ */
+u32_t modem_cache_at_count_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* MODEM_CACHE_H__ */
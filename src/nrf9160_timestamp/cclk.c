@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+
+#include "cclk.h"
+
+/* Time zone offset limit, in quarters of an hour. */
+#define CCLK_TIME_ZONE_MAX 96
+
+/* Converts a broken-down UTC date to milliseconds since the UNIX epoch
+ * without going through mktime(), which pulls in the newlib time zone and
+ * locale machinery. The year is shifted to start in March so that the leap
+ * day is the last day of the year.
+ */
+s64_t date_time_to_epoch_ms(int year, int mon, int mday,
+			    int hour, int min, int sec)
+{
+	int y = year - (mon <= 2);
+	int era = y / 400;
+	int yoe = y - era * 400;
+	int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + mday - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	s64_t days = (s64_t)era * 146097 + doe - 719468;
+
+	return ((days * 86400) + hour * 3600 + min * 60 + sec) * 1000;
+}
+
+static bool is_leap_year(int year)
+{
+	return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+static int days_in_month(int year, int mon)
+{
+	static const u8_t days[] = {
+		31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+	};
+
+	if (mon == 2 && is_leap_year(year)) {
+		return 29;
+	}
+
+	return days[mon - 1];
+}
+
+/* Reads a two digit field at *pos and advances past it and the expected
+ * separator. A separator of 0 means that no separator is consumed.
+ */
+static int parse_field(const char **pos, char separator)
+{
+	const char *p = *pos;
+	int value;
+
+	if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+		return -EBADMSG;
+	}
+
+	value = (p[0] - '0') * 10 + (p[1] - '0');
+	p += 2;
+
+	if (separator) {
+		if (*p != separator) {
+			return -EBADMSG;
+		}
+		p++;
+	}
+
+	*pos = p;
+
+	return value;
+}
+
+/* Parses a +CCLK response on the form
+ * +CCLK: "yy/MM/dd,hh:mm:ss±zz"
+ * where the time is local time and zz is the offset to UTC in quarters of
+ * an hour. The fields are read in place, in a single pass, and converted
+ * to UTC milliseconds since the UNIX epoch.
+ */
+int parse_cclk_response(const char *response, s64_t *epoch_ms)
+{
+	const char *p = strchr(response, '"');
+	int year, mon, mday, hour, min, sec;
+	int tz = 0;
+	int tz_sign;
+
+	if (p == NULL) {
+		return -EBADMSG;
+	}
+
+	p++;
+
+	if ((year = parse_field(&p, '/')) < 0 ||
+	    (mon  = parse_field(&p, '/')) < 0 ||
+	    (mday = parse_field(&p, ',')) < 0 ||
+	    (hour = parse_field(&p, ':')) < 0 ||
+	    (min  = parse_field(&p, ':')) < 0 ||
+	    (sec  = parse_field(&p, 0)) < 0) {
+		return -EBADMSG;
+	}
+
+	if (*p == '+' || *p == '-') {
+		tz_sign = (*p == '+') ? 1 : -1;
+		p++;
+
+		/* The time zone may be given with one or two digits. */
+		if (*p < '0' || *p > '9') {
+			return -EBADMSG;
+		}
+
+		while (*p >= '0' && *p <= '9') {
+			tz = tz * 10 + (*p - '0');
+			p++;
+		}
+
+		if (tz > CCLK_TIME_ZONE_MAX) {
+			return -EBADMSG;
+		}
+
+		tz *= tz_sign;
+	}
+
+	if (*p != '"') {
+		return -EBADMSG;
+	}
+
+	year += 2000;
+
+	if (mon < 1 || mon > 12 || mday < 1 ||
+	    mday > days_in_month(year, mon) ||
+	    hour > 23 || min > 59 || sec > 59) {
+		return -EBADMSG;
+	}
+
+	if (year < CCLK_YEAR_MIN) {
+		return -ENOMSG;
+	}
+
+	*epoch_ms = date_time_to_epoch_ms(year, mon, mday, hour, min, sec) -
+		    (s64_t)tz * 15 * 60 * 1000;
+
+	return 0;
+}
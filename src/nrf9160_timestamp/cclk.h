@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Parsing of the modem network time, without kernel dependencies
+ *	    so that it can be tested on the host.
+ */
+
+#ifndef CCLK_H__
+#define CCLK_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Earliest year accepted from the modem. The modem reports 2015
+ *	   when it has not received network time.
+ */
+#define CCLK_YEAR_MIN 2019
+
+/**
+ * @brief Converts a broken-down UTC date to milliseconds since the UNIX
+ *	  epoch.
+ *
+ * @param year Full year, e.g. 2019.
+ * @param mon Month, 1-12.
+ * @param mday Day of the month, 1-31.
+ * @param hour Hour, 0-23.
+ * @param min Minute, 0-59.
+ * @param sec Second, 0-59.
+ */
+s64_t date_time_to_epoch_ms(int year, int mon, int mday,
+			    int hour, int min, int sec);
+
+/**
+ * @brief Parses a +CCLK response to UTC milliseconds since the UNIX epoch.
+ *
+ * @param response Response on the form +CCLK: "yy/MM/dd,hh:mm:ss±zz",
+ *		   with the local time and the offset to UTC in quarters
+ *		   of an hour.
+ * @param epoch_ms Set to the UTC time on success.
+ *
+ * @return 0 on success, -ENOMSG if the time is before CCLK_YEAR_MIN,
+ *	   -EBADMSG if the response is malformed.
+ */
+int parse_cclk_response(const char *response, s64_t *epoch_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CCLK_H__ */
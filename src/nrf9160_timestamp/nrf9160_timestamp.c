@@ -15,13 +15,17 @@
 #include <string.h>
 #include <net/sntp.h>
 #include <net/socketutils.h>
+#include <app_trace.h>
+#include <metrics.h>
+
+#include "cclk.h"
 
 #include <logging/log.h>
 
 LOG_MODULE_REGISTER(nrf9160_timestamp, CONFIG_NRF9160_TIMESTAMP_LOG_LEVEL);
 
 #define AT_CMD_MODEM_DATE_TIME                  "AT+CCLK?"
-#define AT_CMD_MODEM_DATE_TIME_REPONSE_LEN      28
+#define AT_CMD_MODEM_DATE_TIME_RESPONSE_MAX_LEN 64
 
 #define UIO_IP "129.240.2.6"
 #define GOOGLE_IP "216.239.35.0"
@@ -56,46 +60,35 @@ struct ntp_servers servers[] = {
         {.server = GOOGLE_IP_4}
 };
 
-static int parse_time_entries(char *datetime_string, int min, int max)
-{
-	char buf[50];
-
-	for (int i = min; i < max + 1; i++) {
-		buf[i - min] = datetime_string[i];
-	}
-
-	return strtol(buf, NULL, 10);
-}
-
 static int get_time_cellular_network(void)
 {
         int err;
-        char buf[AT_CMD_MODEM_DATE_TIME_REPONSE_LEN + 5];
-        struct tm date_time;
+        char buf[AT_CMD_MODEM_DATE_TIME_RESPONSE_MAX_LEN];
+        s64_t epoch_ms;
 
+        APP_TRACE_BEGIN(APP_TRACE_NETWORK_TIME);
         err = at_cmd_write(AT_CMD_MODEM_DATE_TIME, buf, sizeof(buf), NULL);
+        APP_TRACE_END(APP_TRACE_NETWORK_TIME);
         if (err) {
                 LOG_DBG("Could not get cellular network time, error: %d", err);
                 return err;
         }
-        buf[AT_CMD_MODEM_DATE_TIME_REPONSE_LEN] = 0;
 
         LOG_DBG("Response from modem: %s", log_strdup(buf));
 
-	date_time.tm_year = parse_time_entries(buf, 8, 9) + 2000 - 1900;
-	date_time.tm_mon  = parse_time_entries(buf, 11, 12) - 1;
-	date_time.tm_mday = parse_time_entries(buf, 14, 15);
-	date_time.tm_hour = parse_time_entries(buf, 17, 18);
-	date_time.tm_min  = parse_time_entries(buf, 20, 21);
-	date_time.tm_sec  = parse_time_entries(buf, 23, 24);
-
-        if (date_time.tm_year == 115 || date_time.tm_year == 0) {
+        err = parse_cclk_response(buf, &epoch_ms);
+        if (err == -ENOMSG) {
                 LOG_DBG("Modem giving old cellular network time");
-                return -ENOMSG;
+                return err;
+        } else if (err) {
+                LOG_DBG("Could not parse cellular network time, error: %d",
+                        err);
+                return err;
         }
 
-	time_aux.date_time_utc = (s64_t)mktime(&date_time) * 1000 - k_uptime_get();
+        time_aux.date_time_utc = epoch_ms - k_uptime_get();
         time_aux.last_date_time_update = k_uptime_get();
+        metrics_gauge_set(METRICS_TIME_SOURCE, METRICS_TIME_SOURCE_NETWORK);
 
         return 0;
 }
@@ -139,8 +132,10 @@ static int get_time_NTP_server(void)
         int i = 0;
 
         while (i < ARRAY_SIZE(servers)) {
+                APP_TRACE_BEGIN(APP_TRACE_NTP);
                 err =  sntp_request_time(servers[i].server,
                                          K_SECONDS(5), &sntp_time);
+                APP_TRACE_END(APP_TRACE_NTP);
                 if (err) {
                         LOG_DBG("Not getting time from NTP server %s, error %d",
                                 log_strdup(servers[i].server), err);
@@ -153,6 +148,8 @@ static int get_time_NTP_server(void)
                         log_strdup(servers[i].server));
                 time_aux.date_time_utc = (s64_t)sntp_time.seconds * 1000 - k_uptime_get();
                 time_aux.last_date_time_update = k_uptime_get();
+                metrics_gauge_set(METRICS_TIME_SOURCE,
+                                  METRICS_TIME_SOURCE_NTP);
                 return 0;
         }
 
@@ -245,11 +242,13 @@ void date_time_set(struct tm *new_date_time)
 {
         time_aux.last_date_time_update = k_uptime_get();
 
-        /* Needed changes so mktime gives UNIX time */
-	new_date_time->tm_year    -= 1900;
-	new_date_time->tm_mon     -= 1;
-
-	time_aux.date_time_utc = (s64_t)mktime(new_date_time) * 1000 - k_uptime_get();
+	time_aux.date_time_utc =
+		date_time_to_epoch_ms(new_date_time->tm_year,
+				      new_date_time->tm_mon,
+				      new_date_time->tm_mday,
+				      new_date_time->tm_hour,
+				      new_date_time->tm_min,
+				      new_date_time->tm_sec) - k_uptime_get();
 }
 
 int date_time_get(s64_t *unix_timestamp_ms)
@@ -23,7 +23,8 @@ void nrf9160_time_init(void);
 
 /** @brief Set current date time (UTC).
  *
- *  @param new_date_time Pointer to a tm structure.
+ *  @param new_date_time Pointer to a tm structure. tm_year holds the full
+ *                       year and tm_mon the month in the range 1 - 12.
  * 
  *  @return 0 If the operation was successful.
  *            Otherwise, a (negative) error code is returned.
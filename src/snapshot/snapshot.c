@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+void snapshot_publish(struct snapshot *snapshot, const void *data)
+{
+	atomic_val_t seq = atomic_get(&snapshot->seq) + 1;
+
+	/* The buffer written to is not the one readers copy from until
+	 * the sequence number is updated.
+	 */
+	memcpy(snapshot->buf[seq & 1], data, snapshot->size);
+	atomic_set(&snapshot->seq, seq);
+}
+
+u32_t snapshot_read(struct snapshot *snapshot, void *data)
+{
+	atomic_val_t seq;
+
+	/* The buffer being copied is only written to again after two more
+	 * records have been published, the sequence number check catches
+	 * the first of them.
+	 */
+	do {
+		seq = atomic_get(&snapshot->seq);
+		memcpy(data, snapshot->buf[seq & 1], snapshot->size);
+	} while (atomic_get(&snapshot->seq) != seq);
+
+	return (u32_t)seq;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Double-buffered snapshots of records shared between threads.
+ *
+ * A single writer publishes complete records into the buffer not being
+ * read, and readers copy the latest record without locking. A reader
+ * retries only if a record was published while it was copying, so a
+ * reader that preempts the writer never waits for it.
+ */
+
+#ifndef SNAPSHOT_H__
+#define SNAPSHOT_H__
+
+#include <zephyr.h>
+#include <atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct snapshot {
+	/** Number of records published, the latest is in buf[seq & 1]. */
+	atomic_t seq;
+	void *buf[2];
+	size_t size;
+};
+
+/**
+ * @brief Defines a snapshot of records of the given type.
+ */
+#define SNAPSHOT_DEFINE(_name, _type)					\
+	static _type _name##_buf[2];					\
+	static struct snapshot _name = {				\
+		.buf = { &_name##_buf[0], &_name##_buf[1] },		\
+		.size = sizeof(_type),					\
+	}
+
+/**
+ * @brief Publishes a record. Must only be called from one thread.
+ *
+ * @param snapshot Snapshot to publish to.
+ * @param data Record to copy into the snapshot.
+ */
+void snapshot_publish(struct snapshot *snapshot, const void *data);
+
+/**
+ * @brief Copies the latest published record.
+ *
+ * @param snapshot Snapshot to read from.
+ * @param data Buffer the record is copied to. Zeroed if nothing has been
+ *	       published yet.
+ *
+ * @return Number of records published up to the copied one, 0 if none.
+ */
+u32_t snapshot_read(struct snapshot *snapshot, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNAPSHOT_H__ */
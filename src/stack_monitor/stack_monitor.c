@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#if defined(CONFIG_SHELL)
+#include <shell/shell.h>
+#endif
+
+#include "stack_monitor.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(stack_monitor, CONFIG_STACK_MONITOR_LOG_LEVEL);
+
+struct thread_entry {
+	const struct k_thread *thread;
+	char name[CONFIG_THREAD_MAX_NAME_LEN];
+	size_t size;
+	size_t high_water;
+	bool seen;
+	bool exited;
+};
+
+/* Kconfig options setting the stack sizes of known threads. */
+static const struct {
+	const char *name;
+	const char *option;
+} options[] = {
+	{ "main", "CONFIG_MAIN_STACK_SIZE" },
+	{ "idle", "CONFIG_IDLE_STACK_SIZE" },
+	{ "sysworkq", "CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE" },
+	{ "logging", "CONFIG_LOG_PROCESS_THREAD_STACK_SIZE" },
+	{ "cloud_poll_thread", "CONFIG_CLOUD_POLL_STACKSIZE" },
+	{ "lte_attach_thread", "CONFIG_LTE_ATTACH_STACKSIZE" },
+	{ "event_bus_thread", "CONFIG_EVENT_BUS_STACK_SIZE" },
+	{ "ntp_thread", "CONFIG_NRF9160_TIME_NTP_THREAD_SIZE" },
+	{ "download_client", "CONFIG_DOWNLOAD_CLIENT_STACK_SIZE" },
+};
+
+static struct thread_entry entries[CONFIG_STACK_MONITOR_MAX_THREADS];
+static size_t entry_cnt;
+
+static struct k_spinlock lock;
+static struct k_delayed_work sample_work;
+static s64_t next_report;
+
+static struct thread_entry *entry_get(const struct k_thread *thread,
+				      const char *name)
+{
+	for (size_t i = 0; i < entry_cnt; i++) {
+		if (entries[i].thread == thread &&
+		    strcmp(entries[i].name, name) == 0) {
+			return &entries[i];
+		}
+	}
+
+	if (entry_cnt == ARRAY_SIZE(entries)) {
+		return NULL;
+	}
+
+	entries[entry_cnt].thread = thread;
+	strncpy(entries[entry_cnt].name, name,
+		sizeof(entries[entry_cnt].name) - 1);
+
+	return &entries[entry_cnt++];
+}
+
+/* Called with the thread list locked, so only the thread is recorded
+ * here. The stack is scanned afterwards.
+ */
+static void thread_collect(const struct k_thread *thread, void *user_data)
+{
+	struct k_thread **threads = user_data;
+
+	for (size_t i = 0; i < CONFIG_STACK_MONITOR_MAX_THREADS; i++) {
+		if (threads[i] == NULL) {
+			threads[i] = (struct k_thread *)thread;
+			return;
+		}
+	}
+}
+
+void stack_monitor_sample(void)
+{
+	struct k_thread *threads[CONFIG_STACK_MONITOR_MAX_THREADS] = { 0 };
+	k_spinlock_key_t key;
+
+	k_thread_foreach(thread_collect, threads);
+
+	key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < entry_cnt; i++) {
+		entries[i].seen = false;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads) && threads[i]; i++) {
+		const char *name = k_thread_name_get(threads[i]);
+		struct thread_entry *entry;
+		size_t unused;
+
+		/* Threads of this application are statically allocated, so
+		 * the stack of a thread that exits after it was collected
+		 * is still valid memory.
+		 */
+		if (k_thread_stack_space_get(threads[i], &unused)) {
+			continue;
+		}
+
+		key = k_spin_lock(&lock);
+
+		entry = entry_get(threads[i], name ? name : "");
+		if (entry) {
+			entry->size = threads[i]->stack_info.size;
+			entry->high_water = MAX(entry->high_water,
+						entry->size - unused);
+			entry->seen = true;
+			entry->exited = false;
+		}
+
+		k_spin_unlock(&lock, key);
+
+		if (entry == NULL) {
+			LOG_WRN("Too many threads to monitor");
+		}
+	}
+
+	key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < entry_cnt; i++) {
+		if (!entries[i].seen) {
+			entries[i].exited = true;
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void stack_monitor_foreach(stack_monitor_cb_t cb, void *user_data)
+{
+	struct stack_monitor_entry entry;
+	k_spinlock_key_t key;
+
+	for (size_t i = 0; i < entry_cnt; i++) {
+		key = k_spin_lock(&lock);
+
+		entry = (struct stack_monitor_entry) {
+			.name = entries[i].name,
+			.size = entries[i].size,
+			.high_water = entries[i].high_water,
+			.exited = entries[i].exited,
+		};
+
+		k_spin_unlock(&lock, key);
+
+		entry.recommended = ROUND_UP(entry.high_water *
+					     (100 + CONFIG_STACK_MONITOR_MARGIN) /
+					     100, CONFIG_STACK_MONITOR_ROUNDING);
+
+		for (size_t j = 0; j < ARRAY_SIZE(options); j++) {
+			if (strcmp(options[j].name, entry.name) == 0) {
+				entry.option = options[j].option;
+				break;
+			}
+		}
+
+		cb(&entry, user_data);
+	}
+}
+
+static void entry_log(const struct stack_monitor_entry *entry,
+		      void *user_data)
+{
+	LOG_INF("%s: %d of %d bytes used, recommended %s=%d%s",
+		log_strdup(entry->name), entry->high_water, entry->size,
+		entry->option ? entry->option : "size",
+		entry->recommended, entry->exited ? " (exited)" : "");
+}
+
+void stack_monitor_report(void)
+{
+	stack_monitor_foreach(entry_log, NULL);
+}
+
+static void sample_work_fn(struct k_work *work)
+{
+	stack_monitor_sample();
+
+	if (CONFIG_STACK_MONITOR_REPORT_INTERVAL > 0 &&
+	    k_uptime_get() >= next_report) {
+		stack_monitor_report();
+		next_report += K_SECONDS(CONFIG_STACK_MONITOR_REPORT_INTERVAL);
+	}
+
+	k_delayed_work_submit(&sample_work,
+			      CONFIG_STACK_MONITOR_SAMPLE_INTERVAL);
+}
+
+void stack_monitor_init(void)
+{
+	next_report = K_SECONDS(CONFIG_STACK_MONITOR_REPORT_INTERVAL);
+
+	k_delayed_work_init(&sample_work, sample_work_fn);
+	k_delayed_work_submit(&sample_work, K_NO_WAIT);
+}
+
+#if defined(CONFIG_SHELL)
+static void entry_print(const struct stack_monitor_entry *entry,
+			void *user_data)
+{
+	const struct shell *shell = user_data;
+
+	shell_print(shell, "%-20s %6u %6u %6u %s%s", entry->name,
+		    entry->size, entry->high_water, entry->recommended,
+		    entry->option ? entry->option : "",
+		    entry->exited ? " (exited)" : "");
+}
+
+static int cmd_stack_monitor(const struct shell *shell, size_t argc,
+			     char **argv)
+{
+	stack_monitor_sample();
+
+	shell_print(shell, "%-20s %6s %6s %6s %s", "thread", "size", "used",
+		    "recom", "option");
+	stack_monitor_foreach(entry_print, (void *)shell);
+
+	return 0;
+}
+
+SHELL_CMD_REGISTER(stack_monitor, NULL,
+		   "Show stack high water marks and recommended sizes",
+		   cmd_stack_monitor);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef STACK_MONITOR_H__
+#define STACK_MONITOR_H__
+
+#include <zephyr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct stack_monitor_entry {
+	const char *name;
+	/** Kconfig option that sets the stack size, NULL if unknown. */
+	const char *option;
+	size_t size;
+	/** Largest number of bytes used since boot. */
+	size_t high_water;
+	/** High water mark plus margin. */
+	size_t recommended;
+	bool exited;
+};
+
+typedef void (*stack_monitor_cb_t)(const struct stack_monitor_entry *entry,
+				   void *user_data);
+
+#if defined(CONFIG_STACK_MONITOR)
+/**
+ * @brief Starts sampling the stack usage of all threads.
+ */
+void stack_monitor_init(void);
+
+/**
+ * @brief Samples the stack usage of all threads now.
+ */
+void stack_monitor_sample(void);
+
+/**
+ * @brief Calls a function for every monitored thread.
+ *
+ * @param cb Function to call.
+ * @param user_data Passed to the function.
+ */
+void stack_monitor_foreach(stack_monitor_cb_t cb, void *user_data);
+
+/**
+ * @brief Logs the high water marks and recommended stack sizes.
+ */
+void stack_monitor_report(void);
+#else
+static inline void stack_monitor_init(void)
+{
+}
+#endif /* CONFIG_STACK_MONITOR */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* STACK_MONITOR_H__ */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <math.h>
+
+#include "track_simplify.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(track_simplify, CONFIG_TRACK_SIMPLIFY_LOG_LEVEL);
+
+#define EARTH_RADIUS_METERS	6371000.0f
+#define PI			3.14159265f
+#define DEG_TO_RAD		(PI / 180.0f)
+
+struct point {
+	float x;
+	float y;
+};
+
+/* Projects a position to meters on a plane tangent at the origin. */
+static struct point project(const struct cloud_data_gps *origin,
+			    const struct cloud_data_gps *pos)
+{
+	float lat = (float)origin->latitude * DEG_TO_RAD;
+
+	return (struct point) {
+		.x = (float)(pos->longitude - origin->longitude) *
+		     DEG_TO_RAD * cosf(lat) * EARTH_RADIUS_METERS,
+		.y = (float)(pos->latitude - origin->latitude) *
+		     DEG_TO_RAD * EARTH_RADIUS_METERS,
+	};
+}
+
+static float length(struct point p)
+{
+	return sqrtf(p.x * p.x + p.y * p.y);
+}
+
+static bool is_stationary(const struct cloud_data_gps *last,
+			  const struct cloud_data_gps *fix)
+{
+	float radius = MAX((float)CONFIG_TRACK_SIMPLIFY_STATIONARY_RADIUS,
+			   fix->accuracy);
+
+	return length(project(last, fix)) <= radius;
+}
+
+/* The last entry can be dropped if it is within the distance dead-band of
+ * the straight path from the previous entry to the new fix, and the
+ * heading changes by less than the heading dead-band at the last entry.
+ */
+static bool is_on_path(const struct cloud_data_gps *prev,
+		       const struct cloud_data_gps *last,
+		       const struct cloud_data_gps *fix)
+{
+	struct point a = project(prev, last);
+	struct point b = project(prev, fix);
+	struct point c = { .x = b.x - a.x, .y = b.y - a.y };
+	float base = length(b);
+	float cross_track, turn;
+
+	if (base < 1.0f) {
+		cross_track = length(a);
+	} else {
+		cross_track = fabsf(a.x * b.y - a.y * b.x) / base;
+	}
+
+	if (cross_track > CONFIG_TRACK_SIMPLIFY_DISTANCE_DEADBAND) {
+		return false;
+	}
+
+	turn = fabsf(atan2f(a.x * c.y - a.y * c.x, a.x * c.x + a.y * c.y));
+
+	return turn <= CONFIG_TRACK_SIMPLIFY_HEADING_DEADBAND * DEG_TO_RAD;
+}
+
+enum track_simplify_action
+track_simplify_check(const struct cloud_data_gps *prev,
+		     const struct cloud_data_gps *last,
+		     const struct cloud_data_gps *fix)
+{
+	/* Entries that have been published are never modified. */
+	if (last == NULL || !last->queued) {
+		return TRACK_SIMPLIFY_APPEND;
+	}
+
+	if (is_stationary(last, fix)) {
+		return TRACK_SIMPLIFY_MERGE;
+	}
+
+	/* Stationary entries carry a duration and are always kept. */
+	if (prev != NULL && last->duration == 0 &&
+	    is_on_path(prev, last, fix)) {
+		return TRACK_SIMPLIFY_REPLACE;
+	}
+
+	return TRACK_SIMPLIFY_APPEND;
+}
+
+void track_simplify_merge(struct cloud_data_gps *last,
+			  const struct cloud_data_gps *fix)
+{
+	if (fix->gps_timestamp > last->gps_timestamp) {
+		last->duration =
+			(fix->gps_timestamp - last->gps_timestamp) / 1000;
+	}
+
+	/* Keep the most accurate estimate of where the device rests. */
+	if (fix->accuracy < last->accuracy) {
+		last->longitude = fix->longitude;
+		last->latitude = fix->latitude;
+		last->altitude = fix->altitude;
+		last->accuracy = fix->accuracy;
+	}
+
+	last->speed = 0;
+
+	LOG_DBG("Stationary for %d seconds", last->duration);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Incremental simplification of the buffered GPS track.
+ */
+
+#ifndef TRACK_SIMPLIFY_H__
+#define TRACK_SIMPLIFY_H__
+
+#include <zephyr.h>
+#include <cloud_codec.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief How a new fix is to be stored in the GPS buffer. */
+enum track_simplify_action {
+	/** Store the fix in a new entry. */
+	TRACK_SIMPLIFY_APPEND,
+	/** The last entry lies on the path, overwrite it with the fix. */
+	TRACK_SIMPLIFY_REPLACE,
+	/** The device is stationary, extend the duration of the last entry. */
+	TRACK_SIMPLIFY_MERGE,
+};
+
+#if defined(CONFIG_TRACK_SIMPLIFY)
+/**
+ * @brief Decides how a new fix is stored, in constant time and memory.
+ *
+ * @param prev Entry before the last entry, or NULL if there is none.
+ * @param last Last entry in the buffer, or NULL if there is none.
+ * @param fix New fix.
+ *
+ * @return Action to take for the new fix.
+ */
+enum track_simplify_action
+track_simplify_check(const struct cloud_data_gps *prev,
+		     const struct cloud_data_gps *last,
+		     const struct cloud_data_gps *fix);
+
+/**
+ * @brief Merges a stationary fix into the last entry.
+ *
+ * @param last Last entry in the buffer.
+ * @param fix New fix.
+ */
+void track_simplify_merge(struct cloud_data_gps *last,
+			  const struct cloud_data_gps *fix);
+#else
+static inline enum track_simplify_action
+track_simplify_check(const struct cloud_data_gps *prev,
+		     const struct cloud_data_gps *last,
+		     const struct cloud_data_gps *fix)
+{
+	return TRACK_SIMPLIFY_APPEND;
+}
+
+static inline void track_simplify_merge(struct cloud_data_gps *last,
+					const struct cloud_data_gps *fix)
+{
+}
+#endif /* CONFIG_TRACK_SIMPLIFY */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACK_SIMPLIFY_H__ */
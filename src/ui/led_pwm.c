@@ -1,25 +1,51 @@
-/*
- * Copyright (c) 2019 Nordic Semiconductor ASA
- *
- * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
- */
-
 #include <zephyr.h>
 #include <pwm.h>
 #include <string.h>
+#if defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
+#include <nrfx_pwm.h>
+#endif
 
 #include "ui.h"
 #include "led_pwm.h"
 #include "led_effect.h"
+#include <app_trace.h>
+#include <metrics.h>
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(led_pwm, CONFIG_UI_LOG_LEVEL);
+
+/* Upper bound of frames in an effect table. A breathe effect needs
+ * 2 * _BREATH_SUBSTEPS + 2 frames before identical frames are merged.
+ */
+#define LED_FRAMES_MAX 48
+
+/* One entry of a precomputed effect table. The color is applied delay
+ * milliseconds after the previous frame.
+ */
+struct led_frame {
+	struct led_color color;
+	u32_t delay;
+};
 
 struct led {
 	struct device *pwm_dev;
 
 	size_t id;
-	struct led_color color;
 	const struct led_effect *effect;
-	u16_t effect_step;
-	u16_t effect_substep;
+
+	struct led_frame frames[LED_FRAMES_MAX];
+	u16_t frame_cnt;
+	u16_t frame;
+	/* Delay of frames merged at the end of the table, added to the first
+	 * frame when looping.
+	 */
+	u32_t loop_delay;
+	bool loop_forever;
+
+	/* Cleared when the LEDs are stopped, so that a work item that was
+	 * already running when it was cancelled does not resubmit itself.
+	 */
+	bool running;
 
 	struct k_delayed_work work;
 };
@@ -101,6 +127,8 @@ static struct led_effect custom_effect =
 			       LED_NOCOLOR());
 
 static struct led leds;
+/* Serializes effect changes with the playback work item. */
+static K_MUTEX_DEFINE(leds_lock);
 static const size_t led_pins[3] = {
 	CONFIG_UI_LED_RED_PIN,
 	CONFIG_UI_LED_GREEN_PIN,
@@ -114,58 +142,219 @@ static void pwm_out(struct led *led, struct led_color *color)
 	}
 }
 
+#if !defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
 static void pwm_off(struct led *led)
 {
 	struct led_color nocolor = { 0 };
 
 	pwm_out(led, &nocolor);
 }
+#endif
 
-static void work_handler(struct k_work *work)
+/* Expands an effect into a table of frames. The interpolation between
+ * steps is done once here, instead of on every substep, and consecutive
+ * frames of the same color are merged into one.
+ */
+static void lut_build(struct led *led, const struct led_effect *effect)
 {
-	struct led *led = CONTAINER_OF(work, struct led, work);
-	const struct led_effect_step *effect_step =
-		&leds.effect->steps[leds.effect_step];
-	int substeps_left = effect_step->substep_cnt - leds.effect_substep;
-
-	for (size_t i = 0; i < ARRAY_SIZE(leds.color.c); i++) {
-		int diff = (effect_step->color.c[i] - leds.color.c[i]) /
-			   substeps_left;
-		leds.color.c[i] += diff;
+	const struct led_effect_step *last =
+		&effect->steps[effect->step_cnt - 1];
+	struct led_color from = last->color;
+	u32_t pending = 0;
+
+	led->frame_cnt = 0;
+	led->loop_forever = effect->loop_forever;
+
+	/* A one-shot effect starts from the dark. */
+	if (!effect->loop_forever) {
+		memset(&from, 0, sizeof(from));
 	}
 
-	pwm_out(led, &leds.color);
+	for (size_t i = 0; i < effect->step_cnt; i++) {
+		const struct led_effect_step *step = &effect->steps[i];
+
+		__ASSERT_NO_MSG(step->substep_cnt > 0);
 
-	leds.effect_substep++;
-	if (leds.effect_substep == effect_step->substep_cnt) {
-		leds.effect_substep = 0;
-		leds.effect_step++;
+		for (size_t k = 1; k <= step->substep_cnt; k++) {
+			struct led_frame frame = {
+				.delay = step->substep_time + pending
+			};
 
-		if (leds.effect_step == leds.effect->step_cnt) {
-			if (leds.effect->loop_forever) {
-				leds.effect_step = 0;
+			for (size_t c = 0; c < ARRAY_SIZE(frame.color.c);
+			     c++) {
+				int diff = step->color.c[c] - from.c[c];
+
+				frame.color.c[c] = from.c[c] +
+						   diff * (int)k /
+						   step->substep_cnt;
 			}
-		} else {
-			__ASSERT_NO_MSG(
-				leds.effect->steps[leds.effect_step].substep_cnt
-				> 0);
+
+			if (led->frame_cnt > 0 &&
+			    !memcmp(&led->frames[led->frame_cnt - 1].color,
+				    &frame.color, sizeof(frame.color))) {
+				pending = frame.delay;
+				continue;
+			}
+
+			if (led->frame_cnt == LED_FRAMES_MAX) {
+				__ASSERT(false, "LED effect table full");
+				break;
+			}
+
+			led->frames[led->frame_cnt++] = frame;
+			pending = 0;
+		}
+
+		from = step->color;
+	}
+
+	led->loop_delay = pending;
+}
+
+#if defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
+/* The PWM peripheral runs from the 125 kHz clock with a top value of 255,
+ * giving a period of 2048 us. Each sequence entry is held for
+ * LED_HW_ENTRY_PERIODS periods.
+ */
+#define LED_HW_PERIOD_US	2048
+#define LED_HW_ENTRY_PERIODS	16
+#define LED_HW_ENTRY_US		(LED_HW_PERIOD_US * LED_HW_ENTRY_PERIODS)
+#define LED_HW_SEQ_MAX		96
+#define LED_HW_POLARITY		BIT(15)
+
+static const nrfx_pwm_t hw_pwm = NRFX_PWM_INSTANCE(1);
+
+/* Sequence 0 plays the effect up to its last frame, sequence 1 holds the
+ * last frame, typically the pause of a breathe effect, with a single
+ * value and a long refresh count.
+ */
+static nrf_pwm_values_individual_t seq0_values[LED_HW_SEQ_MAX];
+static nrf_pwm_values_individual_t seq1_values[1];
+
+static void hw_value_set(nrf_pwm_values_individual_t *value,
+			 const struct led_color *color)
+{
+	value->channel_0 = color->c[0] | LED_HW_POLARITY;
+	value->channel_1 = color->c[1] | LED_HW_POLARITY;
+	value->channel_2 = color->c[2] | LED_HW_POLARITY;
+	value->channel_3 = 0;
+}
+
+static int hw_init(void)
+{
+	nrfx_pwm_config_t config = {
+		.output_pins = {
+			CONFIG_UI_LED_RED_PIN,
+			CONFIG_UI_LED_GREEN_PIN,
+			CONFIG_UI_LED_BLUE_PIN,
+			NRFX_PWM_PIN_NOT_USED
+		},
+		.irq_priority = NRFX_PWM_DEFAULT_CONFIG_IRQ_PRIORITY,
+		.base_clock = NRF_PWM_CLK_125kHz,
+		.count_mode = NRF_PWM_MODE_UP,
+		.top_value = 255,
+		.load_mode = NRF_PWM_LOAD_INDIVIDUAL,
+		.step_mode = NRF_PWM_STEP_AUTO,
+	};
+
+	/* No handler, the sequences are played without CPU interaction. */
+	if (nrfx_pwm_init(&hw_pwm, &config, NULL) != NRFX_SUCCESS) {
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static void hw_play(struct led *led)
+{
+	nrf_pwm_sequence_t seq0 = {
+		.values.p_individual = seq0_values,
+		.repeats = LED_HW_ENTRY_PERIODS - 1,
+	};
+	nrf_pwm_sequence_t seq1 = {
+		.values.p_individual = seq1_values,
+		.length = NRF_PWM_VALUES_LENGTH(seq1_values),
+	};
+	size_t last = led->frame_cnt - 1;
+	size_t entries = 0;
+	u32_t hold;
+
+	nrfx_pwm_stop(&hw_pwm, true);
+
+	for (size_t i = 0; i < last; i++) {
+		/* A frame is shown until the next frame is applied. */
+		size_t repeat = MAX(1, (led->frames[i + 1].delay * 1000 +
+					LED_HW_ENTRY_US / 2) /
+				       LED_HW_ENTRY_US);
+
+		while (repeat-- && entries < LED_HW_SEQ_MAX) {
+			hw_value_set(&seq0_values[entries++],
+				     &led->frames[i].color);
 		}
 	}
 
-	if (leds.effect_step < leds.effect->step_cnt) {
-		s32_t next_delay =
-			leds.effect->steps[leds.effect_step].substep_time;
+	hold = led->loop_forever ?
+	       led->frames[0].delay + led->loop_delay : 0;
+
+	hw_value_set(&seq1_values[0], &led->frames[last].color);
+	seq1.repeats = MAX(1, (hold * 1000) / LED_HW_PERIOD_US) - 1;
 
-		k_delayed_work_submit(&leds.work, next_delay);
+	if (entries == 0) {
+		nrfx_pwm_simple_playback(&hw_pwm, &seq1, 1,
+					 led->loop_forever ?
+					 NRFX_PWM_FLAG_LOOP : 0);
+		return;
 	}
+
+	seq0.length = entries * (sizeof(seq0_values[0]) / sizeof(u16_t));
+
+	nrfx_pwm_complex_playback(&hw_pwm, &seq0, &seq1, 1,
+				  led->loop_forever ? NRFX_PWM_FLAG_LOOP : 0);
+}
+#endif /* CONFIG_UI_LED_PWM_HW_SEQUENCE */
+
+static void work_handler(struct k_work *work)
+{
+	struct led *led = CONTAINER_OF(work, struct led, work);
+	s32_t next_delay;
+
+	APP_TRACE_BEGIN(APP_TRACE_LED);
+	k_mutex_lock(&leds_lock, K_FOREVER);
+
+	if (!led->running) {
+		goto exit;
+	}
+
+	metrics_counter_inc(METRICS_LED_WAKEUPS);
+
+	pwm_out(led, &led->frames[led->frame].color);
+
+	led->frame++;
+	if (led->frame == led->frame_cnt) {
+		if (!led->loop_forever) {
+			led->running = false;
+			goto exit;
+		}
+
+		led->frame = 0;
+		next_delay = led->frames[0].delay + led->loop_delay;
+	} else {
+		next_delay = led->frames[led->frame].delay;
+	}
+
+	k_delayed_work_submit(&led->work, next_delay);
+
+exit:
+	k_mutex_unlock(&leds_lock);
+	APP_TRACE_END(APP_TRACE_LED);
 }
 
 static void led_update(struct led *led)
 {
 	k_delayed_work_cancel(&led->work);
 
-	led->effect_step = 0;
-	led->effect_substep = 0;
+	led->frame = 0;
+	led->running = false;
 
 	if (!led->effect) {
 		printk("No effect set");
@@ -174,14 +363,19 @@ static void led_update(struct led *led)
 
 	__ASSERT_NO_MSG(led->effect->steps);
 
-	if (led->effect->step_cnt > 0) {
-		s32_t next_delay =
-			led->effect->steps[led->effect_step].substep_time;
-
-		k_delayed_work_submit(&led->work, next_delay);
-	} else {
+	if (led->effect->step_cnt == 0) {
 		printk("LED effect with no effect");
+		return;
 	}
+
+	lut_build(led, led->effect);
+	led->running = true;
+
+#if defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
+	hw_play(led);
+#else
+	k_delayed_work_submit(&led->work, led->frames[0].delay);
+#endif
 }
 
 int ui_leds_init(void)
@@ -199,7 +393,18 @@ int ui_leds_init(void)
 	}
 
 	k_delayed_work_init(&leds.work, work_handler);
+
+#if defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
+	err = hw_init();
+	if (err) {
+		LOG_ERR("Could not initialize PWM sequence playback");
+		return err;
+	}
+#endif
+
+	k_mutex_lock(&leds_lock, K_FOREVER);
 	led_update(&leds);
+	k_mutex_unlock(&leds_lock);
 
 	return err;
 }
@@ -214,12 +419,17 @@ void ui_leds_start(void)
 		printk("PWM enable failed\n");
 	}
 #endif
+	k_mutex_lock(&leds_lock, K_FOREVER);
 	led_update(&leds);
+	k_mutex_unlock(&leds_lock);
 }
 
 void ui_leds_stop(void)
 {
+	k_mutex_lock(&leds_lock, K_FOREVER);
+	leds.running = false;
 	k_delayed_work_cancel(&leds.work);
+
 #ifdef CONFIG_DEVICE_POWER_MANAGEMENT
 	int err = device_set_power_state(leds.pwm_dev,
 					 DEVICE_PM_SUSPEND_STATE,
@@ -228,13 +438,28 @@ void ui_leds_stop(void)
 		LOG_ERR("PWM disable failed");
 	}
 #endif
+#if defined(CONFIG_UI_LED_PWM_HW_SEQUENCE)
+	nrfx_pwm_stop(&hw_pwm, true);
+#else
 	pwm_off(&leds);
+#endif
+	k_mutex_unlock(&leds_lock);
 }
 
 void ui_led_set_effect(enum ui_led_pattern state)
 {
-	leds.effect = &effect[state];
-	led_update(&leds);
+	k_mutex_lock(&leds_lock, K_FOREVER);
+
+	/* Restarting a looping effect that is already playing would only
+	 * cause a visible glitch.
+	 */
+	if (leds.effect != &effect[state] || !leds.running ||
+	    !leds.effect->loop_forever) {
+		leds.effect = &effect[state];
+		led_update(&leds);
+	}
+
+	k_mutex_unlock(&leds_lock);
 }
 
 int ui_led_set_rgb(u8_t red, u8_t green, u8_t blue)
@@ -244,11 +469,15 @@ int ui_led_set_rgb(u8_t red, u8_t green, u8_t blue)
 				       UI_LED_OFF_PERIOD_NORMAL,
 				       LED_COLOR(red, green, blue));
 
+	k_mutex_lock(&leds_lock, K_FOREVER);
+
 	memcpy((void *)custom_effect.steps, (void *)effect.steps,
 	       effect.step_cnt * sizeof(struct led_effect_step));
 
 	leds.effect = &custom_effect;
 	led_update(&leds);
 
+	k_mutex_unlock(&leds_lock);
+
 	return 0;
 }
@@ -11,31 +11,317 @@
 
 LOG_MODULE_REGISTER(ui, CONFIG_UI_LOG_LEVEL);
 
+/* Patterns are set in layers. The highest layer that is set is shown,
+ * so that errors override activity indication, and activity indication
+ * overrides the device mode.
+ */
+enum ui_layer {
+	UI_LAYER_MODE,
+	UI_LAYER_ACTIVITY,
+	UI_LAYER_ERROR,
+
+	UI_LAYER_COUNT
+};
+
+static enum ui_led_pattern layers[UI_LAYER_COUNT];
+static bool layer_set[UI_LAYER_COUNT];
+/* The activity layer is cleared when it has not been refreshed for
+ * CONFIG_UI_LED_ACTIVITY_HOLD_TIME milliseconds.
+ */
+static s64_t activity_expiry;
+static bool activity_pending;
+static struct k_delayed_work activity_work;
+/* Shows a pattern set from an interrupt or exception, where the LED
+ * driver cannot be called.
+ */
+static struct k_work show_work;
+static struct k_spinlock lock;
+
 static enum ui_led_pattern current_led_state;
 
-void ui_led_set_pattern(enum ui_led_pattern state)
+static bool is_error_pattern(enum ui_led_pattern state)
+{
+	switch (state) {
+	case UI_LED_ERROR_CLOUD:
+	case UI_LED_ERROR_BSD_REC:
+	case UI_LED_ERROR_BSD_IRREC:
+	case UI_LED_ERROR_LTE_LC:
+	case UI_LED_ERROR_UNKNOWN:
+	case UI_LED_ERROR_SYSTEM_FAULT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static enum ui_layer layer_get(enum ui_led_pattern state)
+{
+	if (is_error_pattern(state)) {
+		return UI_LAYER_ERROR;
+	}
+
+	if (state == UI_CLOUD_PUBLISHING) {
+		return UI_LAYER_ACTIVITY;
+	}
+
+	return UI_LAYER_MODE;
+}
+
+#if defined(CONFIG_UI_LED_USE_PWM)
+static struct k_delayed_work leds_timeout_work;
+static bool leds_active;
+static s64_t leds_active_since;
+static s64_t leds_active_time;
+/* End of the window opened by the last wake-up in the field profile. */
+static s64_t leds_wake_expiry;
+
+static void leds_activate(void)
+{
+	if (!leds_active) {
+		leds_active = true;
+		leds_active_since = k_uptime_get();
+		ui_leds_start();
+	}
+}
+
+static void leds_deactivate(void)
+{
+	if (leds_active) {
+		leds_active = false;
+		leds_active_time += k_uptime_get() - leds_active_since;
+		ui_leds_stop();
+
+		LOG_INF("LEDs off, active %d%% of the time since boot",
+			ui_led_active_time_percent());
+	}
+}
+
+static void leds_timeout_work_fn(struct k_work *work)
+{
+	/* Errors stay visible until they are cleared. */
+	if (is_error_pattern(current_led_state)) {
+		return;
+	}
+
+	leds_deactivate();
+}
+#endif /* CONFIG_UI_LED_USE_PWM */
+
+/* Shows the resolved pattern. It is read again here rather than passed
+ * by the caller, so that the last of two concurrent updates always shows
+ * the latest pattern.
+ */
+static void pattern_show(void)
 {
-	current_led_state = state;
 #ifdef CONFIG_UI_LED_USE_PWM
+	enum ui_led_pattern state = current_led_state;
+
+	if (IS_ENABLED(CONFIG_UI_PROFILE_FIELD)) {
+		/* LEDs turned on for an error are turned off when it is
+		 * cleared, unless a wake-up window is still open.
+		 */
+		if (is_error_pattern(state)) {
+			leds_activate();
+		} else if (k_uptime_get() >= leds_wake_expiry) {
+			leds_deactivate();
+		}
+
+		if (!leds_active) {
+			return;
+		}
+	}
+
 	ui_led_set_effect(state);
 #endif  /* CONFIG_UI_LED_USE_PWM */
 }
 
+/* Must be called with the lock held. Returns true if the pattern to show
+ * changed.
+ */
+static bool pattern_resolve(void)
+{
+	enum ui_led_pattern state = current_led_state;
+
+	for (int i = UI_LAYER_COUNT - 1; i >= 0; i--) {
+		if (layer_set[i]) {
+			state = layers[i];
+			break;
+		}
+	}
+
+	if (state == current_led_state) {
+		return false;
+	}
+
+	current_led_state = state;
+
+	return true;
+}
+
+static void show_work_fn(struct k_work *work)
+{
+	pattern_show();
+}
+
+/* The LED driver takes a mutex, so a pattern set from an interrupt or
+ * from the fatal error handler is only recorded here and shown from the
+ * workqueue. After a fatal error the device reboots before that.
+ */
+static void pattern_changed(void)
+{
+	if (k_is_in_isr()) {
+		k_work_submit(&show_work);
+	} else {
+		pattern_show();
+	}
+}
+
+static void activity_work_fn(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	s64_t remaining = activity_expiry - k_uptime_get();
+	bool changed;
+
+	/* Refreshing the activity only moves the expiry, the work item is
+	 * resubmitted here for the remaining time.
+	 */
+	if (remaining > 0) {
+		k_spin_unlock(&lock, key);
+		k_delayed_work_submit(&activity_work, (s32_t)remaining);
+		return;
+	}
+
+	activity_pending = false;
+	layer_set[UI_LAYER_ACTIVITY] = false;
+	changed = pattern_resolve();
+
+	k_spin_unlock(&lock, key);
+
+	if (changed) {
+		pattern_show();
+	}
+}
+
+void ui_led_set_pattern(enum ui_led_pattern state)
+{
+	enum ui_layer layer = layer_get(state);
+	bool schedule = false;
+	k_spinlock_key_t key;
+	bool changed;
+
+	key = k_spin_lock(&lock);
+
+	layers[layer] = state;
+	layer_set[layer] = true;
+
+	if (layer == UI_LAYER_ACTIVITY) {
+		activity_expiry = k_uptime_get() +
+				  CONFIG_UI_LED_ACTIVITY_HOLD_TIME;
+		schedule = !activity_pending;
+		activity_pending = true;
+	}
+
+	changed = pattern_resolve();
+
+	k_spin_unlock(&lock, key);
+
+	if (schedule) {
+		k_delayed_work_submit(&activity_work,
+				      CONFIG_UI_LED_ACTIVITY_HOLD_TIME);
+	}
+
+	if (changed) {
+		pattern_changed();
+	}
+}
+
+void ui_led_clear_error(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool changed;
+
+	layer_set[UI_LAYER_ERROR] = false;
+	changed = pattern_resolve();
+
+	k_spin_unlock(&lock, key);
+
+	if (changed) {
+		pattern_changed();
+	}
+}
+
 enum ui_led_pattern ui_led_get_pattern(void)
 {
 	return current_led_state;
 }
 
+void ui_led_wake(void)
+{
+#if defined(CONFIG_UI_LED_USE_PWM)
+	if (!IS_ENABLED(CONFIG_UI_PROFILE_FIELD)) {
+		return;
+	}
+
+	leds_wake_expiry = k_uptime_get() +
+			   K_SECONDS(CONFIG_UI_FIELD_LED_ON_TIME);
+	leds_activate();
+	ui_led_set_effect(current_led_state);
+	k_delayed_work_submit(&leds_timeout_work,
+			      K_SECONDS(CONFIG_UI_FIELD_LED_ON_TIME));
+#endif
+}
+
+bool ui_led_is_active(void)
+{
+#if defined(CONFIG_UI_LED_USE_PWM)
+	return !IS_ENABLED(CONFIG_UI_PROFILE_FIELD) || leds_active;
+#else
+	return false;
+#endif
+}
+
+int ui_led_active_time_percent(void)
+{
+#if defined(CONFIG_UI_LED_USE_PWM)
+	s64_t uptime = k_uptime_get();
+	s64_t active = leds_active_time;
+
+	if (leds_active) {
+		active += uptime - leds_active_since;
+	}
+
+	return uptime > 0 ? (int)(active * 100 / uptime) : 100;
+#else
+	return 0;
+#endif
+}
+
 int ui_init(void)
 {
 	int err = 0;
 
+	k_delayed_work_init(&activity_work, activity_work_fn);
+	k_work_init(&show_work, show_work_fn);
+
 #ifdef CONFIG_UI_LED_USE_PWM
 	err = ui_leds_init();
 	if (err) {
 		LOG_ERR("Error when initializing PWM controlled LEDs");
 		return err;
 	}
+
+	leds_active = true;
+	leds_active_since = k_uptime_get();
+
+	k_delayed_work_init(&leds_timeout_work, leds_timeout_work_fn);
+
+	/* Show the boot sequence for a while in the field profile. */
+	if (IS_ENABLED(CONFIG_UI_PROFILE_FIELD)) {
+		leds_wake_expiry = leds_active_since +
+				   K_SECONDS(CONFIG_UI_FIELD_LED_ON_TIME);
+		k_delayed_work_submit(&leds_timeout_work,
+				      K_SECONDS(CONFIG_UI_FIELD_LED_ON_TIME));
+	}
 #endif  /* CONFIG_UI_LED_USE_PWM */
 	return err;
 }
@@ -43,8 +329,7 @@ int ui_init(void)
 void ui_stop_leds(void)
 {
 #ifdef CONFIG_UI_LED_USE_PWM
-	ui_leds_stop();
+	k_delayed_work_cancel(&leds_timeout_work);
+	leds_deactivate();
 #endif
 }
-
-
@@ -100,12 +100,20 @@ enum ui_led_pattern {
 int ui_init(void);
 
 /**
- * @brief Sets the LED pattern.
+ * @brief Sets the LED pattern. Can be called from interrupts and the
+ *	  fatal error handler, the pattern is then shown from the system
+ *	  workqueue.
  *
  * @param pattern LED pattern.
  */
 void ui_led_set_pattern(enum ui_led_pattern pattern);
 
+/**
+ * @brief Clears the error pattern, so that the patterns below it are
+ *	  shown again.
+ */
+void ui_led_clear_error(void);
+
 /**
  * @brief Gets the LED pattern.
  *
@@ -129,6 +137,26 @@ int ui_led_set_color(u8_t red, u8_t green, u8_t blue);
  */
 void ui_stop_leds(void);
 
+/**
+ * @brief Shows LED patterns for CONFIG_UI_FIELD_LED_ON_TIME seconds.
+ *
+ * Only has an effect in the field profile, where LED patterns are
+ * otherwise only shown after boot and on errors. Intended to be called on
+ * user interaction, such as a button press.
+ */
+void ui_led_wake(void);
+
+/**
+ * @brief Returns true if LED patterns are currently shown.
+ */
+bool ui_led_is_active(void);
+
+/**
+ * @brief Returns the share of the uptime the LEDs have been active, in
+ *	  percent.
+ */
+int ui_led_active_time_percent(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Expected times are from Python's calendar.timegm(). After the checks,
+ * the parse rate is compared with the mktime() based parsing it replaced.
+ * The rates are reported only, as host timings do not carry over to the
+ * device.
+ */
+
+#include <zephyr.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cclk.h>
+
+#define BENCH_RUNS	200000
+
+static int failures;
+
+/* Complete responses in the form the modem returns them. */
+static const char * const responses[] = {
+	"+CCLK: \"19/11/04,09:12:45+04\"\r\nOK\r\n",
+	"+CCLK: \"19/12/31,23:59:59+00\"\r\nOK\r\n",
+	"+CCLK: \"20/02/29,06:30:00-20\"\r\nOK\r\n",
+	"+CCLK: \"19/06/01,12:00:00+23\"\r\nOK\r\n",
+};
+
+static void check_epoch(int year, int mon, int mday, s64_t expected)
+{
+	s64_t ms = date_time_to_epoch_ms(year, mon, mday, 0, 0, 0);
+
+	if (ms != expected) {
+		printf("%04d-%02d-%02d: %" PRId64 ", expected %" PRId64 "\n",
+		       year, mon, mday, ms, expected);
+		failures++;
+	}
+}
+
+static void check_parse(const char *response, int expected_err,
+			s64_t expected_ms)
+{
+	s64_t ms = -1;
+	int err = parse_cclk_response(response, &ms);
+
+	if (err != expected_err || (!err && ms != expected_ms)) {
+		printf("%s: error %d, %" PRId64 ", expected error %d, %" PRId64
+		       "\n", response, err, ms, expected_err, expected_ms);
+		failures++;
+	}
+}
+
+/* The parsing before the single-pass parser: fixed field offsets, a
+ * strtol() per field and mktime(), with the time zone ignored.
+ */
+static int field_get(const char *response, int offset)
+{
+	char buf[3] = { response[offset], response[offset + 1], '\0' };
+
+	return strtol(buf, NULL, 10);
+}
+
+static s64_t mktime_parse(const char *response)
+{
+	struct tm date_time = {
+		.tm_year = field_get(response, 8) + 2000 - 1900,
+		.tm_mon = field_get(response, 11) - 1,
+		.tm_mday = field_get(response, 14),
+		.tm_hour = field_get(response, 17),
+		.tm_min = field_get(response, 20),
+		.tm_sec = field_get(response, 23),
+	};
+
+	return (s64_t)mktime(&date_time) * 1000;
+}
+
+static double elapsed_ns(const struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 +
+	       (end.tv_nsec - start->tv_nsec);
+}
+
+static void bench(void)
+{
+	const double count = (double)BENCH_RUNS * ARRAY_SIZE(responses);
+	volatile s64_t sink = 0;
+	struct timespec start;
+	s64_t ms;
+
+	/* mktime() converts local time. */
+	setenv("TZ", "UTC", 1);
+	tzset();
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(responses); j++) {
+			parse_cclk_response(responses[j], &ms);
+			sink += ms;
+		}
+	}
+	printf("parse_cclk_response: %.1f ns per response\n",
+	       elapsed_ns(&start) / count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		for (size_t j = 0; j < ARRAY_SIZE(responses); j++) {
+			sink += mktime_parse(responses[j]);
+		}
+	}
+	printf("strtol and mktime:   %.1f ns per response\n",
+	       elapsed_ns(&start) / count);
+}
+
+int main(void)
+{
+	/* Century rules of the leap years, and the epoch. */
+	check_epoch(1970, 1, 1, 0);
+	check_epoch(2000, 2, 29, 951782400000);
+	check_epoch(2100, 3, 1, 4107542400000);
+
+	/* Leap days. */
+	check_parse("+CCLK: \"20/02/29,12:00:00+00\"", 0, 1582977600000);
+	check_parse("+CCLK: \"24/02/29,23:59:59+00\"", 0, 1709251199000);
+	check_parse("+CCLK: \"19/02/29,12:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"21/02/29,12:00:00+00\"", -EBADMSG, 0);
+
+	/* Month ends. */
+	check_parse("+CCLK: \"19/12/31,23:59:59+00\"", 0, 1577836799000);
+	check_parse("+CCLK: \"19/04/30,08:30:00+04\"", 0, 1556609400000);
+	check_parse("+CCLK: \"19/04/31,08:30:00+04\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/01/32,00:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/13/01,00:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/00/01,00:00:00+00\"", -EBADMSG, 0);
+
+	/* Time zones: UTC-5, UTC+5:45, the limit, one digit and none. */
+	check_parse("+CCLK: \"19/06/01,12:00:00-20\"", 0, 1559408400000);
+	check_parse("+CCLK: \"19/06/01,12:00:00+23\"", 0, 1559369700000);
+	check_parse("+CCLK: \"19/06/01,12:00:00+96\"", 0, 1559304000000);
+	check_parse("+CCLK: \"19/06/01,12:00:00+4\"", 0, 1559386800000);
+	check_parse("+CCLK: \"19/06/01,12:00:00\"", 0, 1559390400000);
+	check_parse("+CCLK: \"19/06/01,12:00:00+97\"", -EBADMSG, 0);
+
+	/* The 2019 floor. */
+	check_parse("+CCLK: \"19/01/01,00:00:00+00\"", 0, 1546300800000);
+	check_parse("+CCLK: \"18/12/31,23:59:59+00\"", -ENOMSG, 0);
+	check_parse("+CCLK: \"15/01/01,00:00:00+00\"", -ENOMSG, 0);
+
+	/* Malformed responses. */
+	check_parse("", -EBADMSG, 0);
+	check_parse("+CCLK: 19/06/01,12:00:00+00", -EBADMSG, 0);
+	check_parse("+CCLK: \"\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:00:00+00", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/6/01,12:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19-06-01,12:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01 12:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,24:00:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:60:00+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:00:60+00\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:00:00+\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"19/06/01,12:00:00+0a\"", -EBADMSG, 0);
+	check_parse("+CCLK: \"1a/06/01,12:00:00+00\"", -EBADMSG, 0);
+
+	bench();
+
+	return failures ? 1 : 0;
+}
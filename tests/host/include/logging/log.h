@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Logging is compiled out in the host tests. */
+
+#ifndef LOG_H__
+#define LOG_H__
+
+#define LOG_MODULE_REGISTER(...)
+#define LOG_DBG(...) do { } while (false)
+#define LOG_INF(...) do { } while (false)
+#define LOG_WRN(...) do { } while (false)
+#define LOG_ERR(...) do { } while (false)
+#define log_strdup(str) (str)
+
+#endif /* LOG_H__ */
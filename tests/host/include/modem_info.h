@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* cloud_codec.h only refers to the modem types through pointers. */
+
+#ifndef MODEM_INFO_H__
+#define MODEM_INFO_H__
+
+struct modem_param_info;
+
+#endif /* MODEM_INFO_H__ */
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* cloud_codec.h only refers to the cloud types through pointers. */
+
+#ifndef CLOUD_H__
+#define CLOUD_H__
+
+struct cloud_msg;
+
+#endif /* CLOUD_H__ */
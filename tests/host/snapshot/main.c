@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* One writer publishes records as fast as it can while readers check
+ * that every copy is complete: the checksum matches, the record is the
+ * one snapshot_read() reports, and the sequence never goes back.
+ */
+
+#include <zephyr.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <snapshot.h>
+
+#define PUBLISHES	2000000
+#define READERS		3
+
+struct record {
+	u32_t seq;
+	u32_t data[29];
+	u32_t checksum;
+};
+
+SNAPSHOT_DEFINE(test_snapshot, struct record);
+
+static volatile bool done;
+
+static u32_t checksum(const struct record *record)
+{
+	u32_t sum = record->seq;
+
+	for (size_t i = 0; i < ARRAY_SIZE(record->data); i++) {
+		sum = sum * 31 + record->data[i];
+	}
+
+	return sum;
+}
+
+static void *writer(void *arg)
+{
+	struct record record;
+
+	for (u32_t seq = 1; seq <= PUBLISHES; seq++) {
+		record.seq = seq;
+		for (size_t i = 0; i < ARRAY_SIZE(record.data); i++) {
+			record.data[i] = seq ^ (i * 0x9e3779b9);
+		}
+		record.checksum = checksum(&record);
+
+		snapshot_publish(&test_snapshot, &record);
+	}
+
+	done = true;
+
+	return NULL;
+}
+
+static void *reader(void *arg)
+{
+	struct record record;
+	u32_t last = 0;
+	u32_t reads = 0;
+	bool finished;
+	u32_t seq;
+
+	/* The last read starts after the writer is done. */
+	do {
+		finished = done;
+		seq = snapshot_read(&test_snapshot, &record);
+		if (seq == 0) {
+			continue;
+		}
+
+		if (record.checksum != checksum(&record)) {
+			printf("Torn record %u\n", record.seq);
+			return (void *)1;
+		}
+
+		if (record.seq != seq || seq < last) {
+			printf("Record %u read as %u after %u\n",
+			       record.seq, seq, last);
+			return (void *)1;
+		}
+
+		last = seq;
+		reads++;
+	} while (!finished);
+
+	printf("Reader: %u reads, last record %u\n", reads, last);
+
+	return last == PUBLISHES ? NULL : (void *)1;
+}
+
+int main(void)
+{
+	pthread_t readers[READERS];
+	pthread_t writer_thread;
+	struct record record;
+	int failed = 0;
+
+	memset(&record, 0xff, sizeof(record));
+	if (snapshot_read(&test_snapshot, &record) != 0 ||
+	    record.seq != 0 || record.checksum != 0) {
+		printf("Snapshot not zeroed before the first publish\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < READERS; i++) {
+		pthread_create(&readers[i], NULL, reader, NULL);
+	}
+	pthread_create(&writer_thread, NULL, writer, NULL);
+
+	pthread_join(writer_thread, NULL);
+	for (size_t i = 0; i < READERS; i++) {
+		void *result;
+
+		pthread_join(readers[i], &result);
+		failed |= result != NULL;
+	}
+
+	return failed;
+}
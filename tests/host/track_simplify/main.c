@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Replays the sample trace of gps_replay through the buffer logic of
+ * populate_gps_buffer() in main.c, and checks the number of each action
+ * and how far the original fixes are from the simplified track. The
+ * replay is then timed over repeated runs; the time is reported only, as
+ * host timings say nothing absolute about the device.
+ */
+
+#include <zephyr.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <track_simplify.h>
+
+#define FIXES_MAX	512
+#define BENCH_RUNS	10000
+
+/* Expected for the sample trace with the Kconfig defaults. */
+#define EXPECTED_APPEND		35
+#define EXPECTED_REPLACE	1
+#define EXPECTED_MERGE		127
+/* No fix is further from the simplified track than the larger of the
+ * dead-bands within which fixes are dropped.
+ */
+#define ERROR_BOUND	MAX(CONFIG_TRACK_SIMPLIFY_DISTANCE_DEADBAND, \
+			    CONFIG_TRACK_SIMPLIFY_STATIONARY_RADIUS)
+
+static struct cloud_data_gps fixes[FIXES_MAX];
+static struct cloud_data_gps track[FIXES_MAX];
+
+static size_t trace_read(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	size_t count = 0;
+	char line[128];
+	long long timestamp;
+	int satellites;
+
+	if (f == NULL) {
+		perror(path);
+		return 0;
+	}
+
+	/* Skip the header. */
+	if (fgets(line, sizeof(line), f) == NULL) {
+		fclose(f);
+		return 0;
+	}
+
+	while (count < FIXES_MAX && fgets(line, sizeof(line), f) != NULL) {
+		struct cloud_data_gps *fix = &fixes[count];
+
+		if (sscanf(line, "%lld,%lf,%lf,%f,%f,%f,%d", &timestamp,
+			   &fix->latitude, &fix->longitude, &fix->altitude,
+			   &fix->accuracy, &fix->speed, &satellites) != 7) {
+			/* No fix within the search timeout. */
+			continue;
+		}
+
+		fix->gps_timestamp = timestamp * 1000;
+		fix->queued = true;
+		count++;
+	}
+
+	fclose(f);
+
+	return count;
+}
+
+/* Distance in meters from p to the segment a-b, on a plane tangent at the
+ * first fix of the trace.
+ */
+static double segment_distance(const struct cloud_data_gps *p,
+			       const struct cloud_data_gps *a,
+			       const struct cloud_data_gps *b)
+{
+	const double m_per_deg = 6371000.0 * M_PI / 180.0;
+	double scale = cos(fixes[0].latitude * M_PI / 180.0);
+	double ax = a->longitude * scale * m_per_deg;
+	double ay = a->latitude * m_per_deg;
+	double dx = b->longitude * scale * m_per_deg - ax;
+	double dy = b->latitude * m_per_deg - ay;
+	double px = p->longitude * scale * m_per_deg - ax;
+	double py = p->latitude * m_per_deg - ay;
+	double len_sq = dx * dx + dy * dy;
+	double t = len_sq > 0 ? (px * dx + py * dy) / len_sq : 0;
+
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+	return hypot(px - t * dx, py - t * dy);
+}
+
+static double track_distance(const struct cloud_data_gps *p, size_t len)
+{
+	double min = segment_distance(p, &track[0], &track[0]);
+
+	for (size_t i = 1; i < len; i++) {
+		min = fmin(min, segment_distance(p, &track[i - 1], &track[i]));
+	}
+
+	return min;
+}
+
+/* Returns the number of entries in the simplified track. */
+static size_t simplify(size_t count, size_t actions[3])
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		enum track_simplify_action action = track_simplify_check(
+			len >= 2 ? &track[len - 2] : NULL,
+			len >= 1 ? &track[len - 1] : NULL,
+			&fixes[i]);
+
+		actions[action]++;
+
+		switch (action) {
+		case TRACK_SIMPLIFY_MERGE:
+			track_simplify_merge(&track[len - 1], &fixes[i]);
+			break;
+		case TRACK_SIMPLIFY_REPLACE:
+			track[len - 1] = fixes[i];
+			break;
+		case TRACK_SIMPLIFY_APPEND:
+			track[len++] = fixes[i];
+			break;
+		}
+	}
+
+	return len;
+}
+
+static void bench(size_t count)
+{
+	size_t actions[3] = { 0 };
+	struct timespec start, end;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		simplify(count, actions);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	printf("%d runs: %.1f ns per fix\n", BENCH_RUNS,
+	       ns / ((double)BENCH_RUNS * count));
+}
+
+int main(void)
+{
+	size_t count = trace_read(TRACE_PATH);
+	size_t actions[3] = { 0 };
+	double max_error = 0;
+	int failed = 0;
+	size_t len;
+
+	if (count == 0) {
+		printf("No fixes in %s\n", TRACE_PATH);
+		return 1;
+	}
+
+	len = simplify(count, actions);
+
+	for (size_t i = 0; i < count; i++) {
+		max_error = fmax(max_error, track_distance(&fixes[i], len));
+	}
+
+	printf("%zu fixes: %zu appended, %zu replaced, %zu merged, "
+	       "%zu retained, max error %.1f m\n", count,
+	       actions[TRACK_SIMPLIFY_APPEND], actions[TRACK_SIMPLIFY_REPLACE],
+	       actions[TRACK_SIMPLIFY_MERGE], len, max_error);
+
+	if (actions[TRACK_SIMPLIFY_APPEND] != EXPECTED_APPEND ||
+	    actions[TRACK_SIMPLIFY_REPLACE] != EXPECTED_REPLACE ||
+	    actions[TRACK_SIMPLIFY_MERGE] != EXPECTED_MERGE) {
+		printf("Expected %d appended, %d replaced, %d merged\n",
+		       EXPECTED_APPEND, EXPECTED_REPLACE, EXPECTED_MERGE);
+		failed = 1;
+	}
+
+	if (max_error > ERROR_BOUND) {
+		printf("Error above the bound of %d m\n", ERROR_BOUND);
+		failed = 1;
+	}
+
+	bench(count);
+
+	return failed;
+}